@@ -0,0 +1,581 @@
+#pragma once
+
+#include "shape.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Bounding volume hierarchy over a mixed set of Circ, Rect and (2D) Poly shapes
+// built top-down with binned SAH, nodes are stored flat in depth-first order
+// (left child directly after its parent) so traversal walks mostly forward through memory
+// moving shapes are handled with update + refit (bounds are recomputed, the tree shape is kept),
+// build again once the tree degrades
+// queries are const and can run concurrently
+
+// T: numerical type (int, float, etc.)
+// D: number of dimensions (D >= 1), Poly shapes need D == 2
+template<class T, dim_t D>
+class BVH {
+  static_assert(D >= 1);
+
+  using S = shape_detail::Real<T>;
+public:
+  // closest shape hit by a line, t is the line parameter (origin + dir * t) where it enters the shape
+  struct Hit {
+    uint32_t id;
+    S t;
+  };
+
+  // adds a shape and returns its id, ids are given out in order starting at 0
+  // the tree only includes shapes added before the last build
+  uint32_t add(const Circ<T, D> &circ) {
+    circs.push_back(circ);
+    return add_ref(Circle, circs.size() - 1);
+  }
+  uint32_t add(const Rect<T, D> &rect) {
+    rects.push_back(rect);
+    return add_ref(Rectangle, rects.size() - 1);
+  }
+  uint32_t add(const Poly<T> &poly) {
+    static_assert(D == 2);
+    polys.push_back(poly);
+    return add_ref(Polygon, polys.size() - 1);
+  }
+
+  // replaces shape id with one of the same kind (false if the kind differs), call refit after moving shapes
+  bool update(uint32_t id, const Circ<T, D> &circ) {
+    if (id >= refs.size() || refs[id].kind != Circle) {
+      return false;
+    }
+    circs[refs[id].index] = circ;
+    return true;
+  }
+  bool update(uint32_t id, const Rect<T, D> &rect) {
+    if (id >= refs.size() || refs[id].kind != Rectangle) {
+      return false;
+    }
+    rects[refs[id].index] = rect;
+    return true;
+  }
+  bool update(uint32_t id, const Poly<T> &poly) {
+    static_assert(D == 2);
+    if (id >= refs.size() || refs[id].kind != Polygon) {
+      return false;
+    }
+    polys[refs[id].index] = poly;
+    return true;
+  }
+
+  void clear() {
+    circs.clear();
+    rects.clear();
+    polys.clear();
+    refs.clear();
+    boxes.clear();
+    order.clear();
+    nodes.clear();
+  }
+
+  size_t size() const { return refs.size(); }
+
+  // builds the tree over all shapes, O(n log n)
+  void build();
+
+  // recomputes all bounds bottom-up after shapes were updated, O(n)
+  void refit();
+
+  // nearest shape hit by a line, ray or segment
+  template<LineType L>
+  bool first_hit(const GenLine<T, D, L> &line, Hit &hit) const;
+
+  // ids of all shapes hit by a line, ray or segment
+  template<LineType L>
+  void all_hits(const GenLine<T, D, L> &line, std::vector<uint32_t> &out) const;
+
+  // ids of all shapes overlapping a rect or circle
+  void overlaps(const Rect<T, D> &rect, std::vector<uint32_t> &out) const { overlaps_helper(rect, out); }
+  void overlaps(const Circ<T, D> &circ, std::vector<uint32_t> &out) const { overlaps_helper(circ, out); }
+
+  // all pairs of overlapping shapes (smaller id first), each reported once
+  void pairs(std::vector<std::pair<uint32_t, uint32_t>> &out) const;
+private:
+  static constexpr size_t bin_count = 16;
+  static constexpr size_t leaf_max = 8; // larger ranges are always split
+
+  enum Kind : uint32_t { Circle, Rectangle, Polygon };
+
+  struct Ref {
+    Kind kind;
+    uint32_t index; // into the vector of its kind
+  };
+
+  // axis aligned bounds
+  struct Box {
+    S lo[D], hi[D];
+
+    static Box empty() {
+      Box res;
+      for (size_t i = 0; i < D; ++i) {
+        res.lo[i] = std::numeric_limits<S>::infinity();
+        res.hi[i] = -std::numeric_limits<S>::infinity();
+      }
+      return res;
+    }
+
+    void grow(const Box &other) {
+      for (size_t i = 0; i < D; ++i) {
+        lo[i] = std::min(lo[i], other.lo[i]);
+        hi[i] = std::max(hi[i], other.hi[i]);
+      }
+    }
+
+    bool overlaps(const Box &other) const {
+      for (size_t i = 0; i < D; ++i) {
+        if (hi[i] < other.lo[i] || other.hi[i] < lo[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // half of the surface measure (perimeter in 2D, surface area in 3D), what SAH weights by
+    S area() const {
+      S res = 0;
+      for (size_t i = 0; i < D; ++i) {
+        S face = 1;
+        for (size_t j = 0; j < D; ++j) {
+          if (j != i) {
+            face *= std::max(hi[j] - lo[j], S(0));
+          }
+        }
+        res += face;
+      }
+      return res;
+    }
+  };
+
+  // inner nodes have count == 0, the left child at the next index and the right child at index
+  // leaves hold order[index, index + count)
+  struct Node {
+    Box box;
+    uint32_t index, count;
+  };
+
+  std::vector<Circ<T, D>> circs;
+  std::vector<Rect<T, D>> rects;
+  std::vector<Poly<T>> polys;
+  std::vector<Ref> refs;     // by id
+  std::vector<Box> boxes;    // by id
+  std::vector<uint32_t> order; // ids in leaf order
+  std::vector<Node> nodes;
+
+  uint32_t add_ref(Kind kind, size_t index) {
+    refs.push_back({ kind, uint32_t(index) });
+    return uint32_t(refs.size() - 1);
+  }
+
+  Box bounds(uint32_t id) const {
+    Ref ref = refs[id];
+    Box res;
+    if (ref.kind == Circle) {
+      const Circ<T, D> &c = circs[ref.index];
+      for (size_t i = 0; i < D; ++i) {
+        res.lo[i] = S(c.pos[i]) - S(c.radius);
+        res.hi[i] = S(c.pos[i]) + S(c.radius);
+      }
+    } else if (ref.kind == Rectangle) {
+      const Rect<T, D> &r = rects[ref.index];
+      for (size_t i = 0; i < D; ++i) {
+        res.lo[i] = S(r.pos[i]);
+        res.hi[i] = S(r.pos[i]) + S(r.size[i]);
+      }
+    } else if constexpr (D == 2) {
+      res = Box::empty();
+      for (const Vec2<T> &p : polys[ref.index]) {
+        for (size_t i = 0; i < D; ++i) {
+          res.lo[i] = std::min(res.lo[i], S(p[i]));
+          res.hi[i] = std::max(res.hi[i], S(p[i]));
+        }
+      }
+    }
+    return res;
+  }
+
+  // exact overlap test between a query shape and shape id
+  template<class Q>
+  bool hits(const Q &q, uint32_t id) const {
+    Ref ref = refs[id];
+    if (ref.kind == Circle) {
+      return q.intersects(circs[ref.index]);
+    }
+    if (ref.kind == Rectangle) {
+      return q.intersects(rects[ref.index]);
+    }
+    if constexpr (D == 2) {
+      return q.intersects(polys[ref.index]);
+    }
+    return false;
+  }
+
+  bool hits(uint32_t a, uint32_t b) const {
+    Ref ref = refs[a];
+    if (ref.kind == Circle) {
+      return hits(circs[ref.index], b);
+    }
+    if (ref.kind == Rectangle) {
+      return hits(rects[ref.index], b);
+    }
+    if constexpr (D == 2) {
+      return hits(polys[ref.index], b);
+    }
+    return false;
+  }
+
+  // clips [t0, t1] of a line to shape id
+  bool clip(uint32_t id, const Vec<S, D> &o, const Vec<S, D> &d, S &t0, S &t1) const {
+    Ref ref = refs[id];
+    if (ref.kind == Circle) {
+      return shape_detail::clip(circs[ref.index], o, d, t0, t1);
+    }
+    if (ref.kind == Rectangle) {
+      return shape_detail::clip(rects[ref.index], o, d, t0, t1);
+    }
+    if constexpr (D == 2) {
+      return shape_detail::clip(polys[ref.index], o, d, t0, t1);
+    }
+    return false;
+  }
+
+  // whether a query shape can overlap a box
+  static bool box_hits(const Box &box, const Rect<T, D> &rect) {
+    for (size_t i = 0; i < D; ++i) {
+      if (box.hi[i] < S(rect.pos[i]) || S(rect.pos[i]) + S(rect.size[i]) < box.lo[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  static bool box_hits(const Box &box, const Circ<T, D> &circ) {
+    S dist_sqd = 0;
+    for (size_t i = 0; i < D; ++i) {
+      S c = S(circ.pos[i]);
+      S d = c < box.lo[i] ? box.lo[i] - c : (c > box.hi[i] ? c - box.hi[i] : 0);
+      dist_sqd += d * d;
+    }
+    return dist_sqd <= S(circ.radius) * S(circ.radius);
+  }
+
+  template<class Q>
+  void overlaps_helper(const Q &q, std::vector<uint32_t> &out) const;
+};
+
+template<class T, dim_t D>
+void BVH<T, D>::build() {
+  size_t n = refs.size();
+  boxes.resize(n);
+  order.resize(n);
+  nodes.clear();
+  if (n == 0) {
+    return;
+  }
+  std::vector<S> centers(n * D);
+  for (uint32_t id = 0; id < n; ++id) {
+    boxes[id] = bounds(id);
+    order[id] = id;
+    for (size_t i = 0; i < D; ++i) {
+      centers[id * D + i] = (boxes[id].lo[i] + boxes[id].hi[i]) / 2;
+    }
+  }
+  nodes.reserve(2 * n);
+
+  struct Task {
+    uint32_t begin, end, parent; // parent == none for the root and left children
+  };
+  constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+  std::vector<Task> stack = { { 0, uint32_t(n), none } };
+  while (!stack.empty()) {
+    Task task = stack.back();
+    stack.pop_back();
+    uint32_t index = uint32_t(nodes.size());
+    if (task.parent != none) {
+      nodes[task.parent].index = index;
+    }
+    Box box = Box::empty(), center_box = Box::empty();
+    for (uint32_t k = task.begin; k < task.end; ++k) {
+      box.grow(boxes[order[k]]);
+      for (size_t i = 0; i < D; ++i) {
+        S c = centers[order[k] * D + i];
+        center_box.lo[i] = std::min(center_box.lo[i], c);
+        center_box.hi[i] = std::max(center_box.hi[i], c);
+      }
+    }
+    nodes.push_back({ box, task.begin, task.end - task.begin });
+    uint32_t count = task.end - task.begin;
+    if (count <= 2) {
+      continue;
+    }
+
+    // binned SAH over every axis, cost is relative to testing one shape (traversal step counted as 1)
+    S best_cost = std::numeric_limits<S>::infinity();
+    size_t best_axis = 0, best_split = 0;
+    for (size_t axis = 0; axis < D; ++axis) {
+      S lo = center_box.lo[axis], extent = center_box.hi[axis] - lo;
+      if (!(extent > 0)) {
+        continue;
+      }
+      Box bin_box[bin_count];
+      uint32_t bin_n[bin_count] = {};
+      std::fill(bin_box, bin_box + bin_count, Box::empty());
+      S scale = S(bin_count) / extent;
+      for (uint32_t k = task.begin; k < task.end; ++k) {
+        size_t b = std::min(size_t((centers[order[k] * D + axis] - lo) * scale), bin_count - 1);
+        ++bin_n[b];
+        bin_box[b].grow(boxes[order[k]]);
+      }
+      // right_area[b]: bins b.. swept from the right
+      S right_area[bin_count];
+      uint32_t right_n[bin_count];
+      Box acc = Box::empty();
+      uint32_t acc_n = 0;
+      for (size_t b = bin_count - 1; b > 0; --b) {
+        acc.grow(bin_box[b]);
+        acc_n += bin_n[b];
+        right_area[b] = acc.area();
+        right_n[b] = acc_n;
+      }
+      acc = Box::empty();
+      acc_n = 0;
+      for (size_t b = 1; b < bin_count; ++b) {
+        acc.grow(bin_box[b - 1]);
+        acc_n += bin_n[b - 1];
+        if (acc_n == 0 || right_n[b] == 0) {
+          continue;
+        }
+        S cost = acc.area() * acc_n + right_area[b] * right_n[b];
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_split = b;
+        }
+      }
+    }
+    S area = box.area();
+    S split_cost = area > 0 ? 1 + best_cost / area : best_cost;
+    if (count <= leaf_max && !(split_cost < count)) {
+      continue;
+    }
+
+    uint32_t *first = order.data() + task.begin, *last = order.data() + task.end, *mid;
+    if (best_cost < std::numeric_limits<S>::infinity()) {
+      S lo = center_box.lo[best_axis], scale = S(bin_count) / (center_box.hi[best_axis] - lo);
+      mid = std::partition(first, last, [&](uint32_t id) {
+        return std::min(size_t((centers[id * D + best_axis] - lo) * scale), bin_count - 1) < best_split;
+      });
+    } else {
+      // all centers coincide, split in half
+      mid = first + count / 2;
+    }
+    uint32_t split = uint32_t(mid - order.data());
+    nodes.back().count = 0;
+    // left is pushed last so it is built next, directly after its parent
+    stack.push_back({ split, task.end, index });
+    stack.push_back({ task.begin, split, none });
+  }
+}
+
+template<class T, dim_t D>
+void BVH<T, D>::refit() {
+  for (uint32_t id = 0; id < boxes.size(); ++id) {
+    boxes[id] = bounds(id);
+  }
+  // children always come after their parent
+  for (size_t i = nodes.size(); i-- > 0;) {
+    Node &node = nodes[i];
+    if (node.count) {
+      node.box = Box::empty();
+      for (uint32_t k = node.index; k < node.index + node.count; ++k) {
+        node.box.grow(boxes[order[k]]);
+      }
+    } else {
+      node.box = nodes[i + 1].box;
+      node.box.grow(nodes[node.index].box);
+    }
+  }
+}
+
+template<class T, dim_t D>
+template<LineType L>
+bool BVH<T, D>::first_hit(const GenLine<T, D, L> &line, Hit &hit) const {
+  Vec<S, D> o = shape_detail::real(line.origin), d = shape_detail::real(line.dir);
+  S start, end;
+  shape_detail::line_range<L>(start, end);
+  bool found = false;
+  // entry parameter of node i within [start, end], false if missed
+  auto enter = [&](uint32_t i, S &t) {
+    S t0 = start, t1 = end;
+    if (!shape_detail::clip_box(nodes[i].box.lo, nodes[i].box.hi, o, d, t0, t1)) {
+      return false;
+    }
+    t = t0;
+    return true;
+  };
+  if (nodes.empty()) {
+    return false;
+  }
+  std::vector<std::pair<uint32_t, S>> stack;
+  S t;
+  if (enter(0, t)) {
+    stack.push_back({ 0, t });
+  }
+  while (!stack.empty()) {
+    auto [i, entry] = stack.back();
+    stack.pop_back();
+    // end shrinks to the best hit so far
+    if (entry > end) {
+      continue;
+    }
+    const Node &node = nodes[i];
+    if (node.count) {
+      for (uint32_t k = node.index; k < node.index + node.count; ++k) {
+        S t0 = start, t1 = end;
+        if (clip(order[k], o, d, t0, t1) && (!found || t0 < end)) {
+          found = true;
+          hit = { order[k], t0 };
+          end = t0;
+        }
+      }
+      continue;
+    }
+    S tl, tr;
+    bool left = enter(i + 1, tl), right = enter(node.index, tr);
+    // nearer child is visited first
+    if (left && right && tr < tl) {
+      stack.push_back({ i + 1, tl });
+      stack.push_back({ node.index, tr });
+    } else {
+      if (right) {
+        stack.push_back({ node.index, tr });
+      }
+      if (left) {
+        stack.push_back({ i + 1, tl });
+      }
+    }
+  }
+  return found;
+}
+
+template<class T, dim_t D>
+template<LineType L>
+void BVH<T, D>::all_hits(const GenLine<T, D, L> &line, std::vector<uint32_t> &out) const {
+  out.clear();
+  if (nodes.empty()) {
+    return;
+  }
+  Vec<S, D> o = shape_detail::real(line.origin), d = shape_detail::real(line.dir);
+  S start, end;
+  shape_detail::line_range<L>(start, end);
+  std::vector<uint32_t> stack = { 0 };
+  while (!stack.empty()) {
+    const Node &node = nodes[stack.back()];
+    uint32_t i = stack.back();
+    stack.pop_back();
+    S t0 = start, t1 = end;
+    if (!shape_detail::clip_box(node.box.lo, node.box.hi, o, d, t0, t1)) {
+      continue;
+    }
+    if (node.count) {
+      for (uint32_t k = node.index; k < node.index + node.count; ++k) {
+        t0 = start;
+        t1 = end;
+        if (clip(order[k], o, d, t0, t1)) {
+          out.push_back(order[k]);
+        }
+      }
+    } else {
+      stack.push_back(node.index);
+      stack.push_back(i + 1);
+    }
+  }
+}
+
+template<class T, dim_t D>
+template<class Q>
+void BVH<T, D>::overlaps_helper(const Q &q, std::vector<uint32_t> &out) const {
+  out.clear();
+  if (nodes.empty()) {
+    return;
+  }
+  std::vector<uint32_t> stack = { 0 };
+  while (!stack.empty()) {
+    uint32_t i = stack.back();
+    const Node &node = nodes[i];
+    stack.pop_back();
+    if (!box_hits(node.box, q)) {
+      continue;
+    }
+    if (node.count) {
+      for (uint32_t k = node.index; k < node.index + node.count; ++k) {
+        if (box_hits(boxes[order[k]], q) && hits(q, order[k])) {
+          out.push_back(order[k]);
+        }
+      }
+    } else {
+      stack.push_back(node.index);
+      stack.push_back(i + 1);
+    }
+  }
+}
+
+// descends pairs of nodes, a node paired with itself splits into both children and the pair between them
+template<class T, dim_t D>
+void BVH<T, D>::pairs(std::vector<std::pair<uint32_t, uint32_t>> &out) const {
+  out.clear();
+  if (nodes.empty()) {
+    return;
+  }
+  auto report = [&](uint32_t a, uint32_t b) {
+    if (boxes[a].overlaps(boxes[b]) && hits(a, b)) {
+      out.push_back({ std::min(a, b), std::max(a, b) });
+    }
+  };
+  std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 0 } };
+  while (!stack.empty()) {
+    auto [a, b] = stack.back();
+    stack.pop_back();
+    const Node &x = nodes[a], &y = nodes[b];
+    if (a == b) {
+      if (x.count) {
+        for (uint32_t i = x.index; i < x.index + x.count; ++i) {
+          for (uint32_t j = i + 1; j < x.index + x.count; ++j) {
+            report(order[i], order[j]);
+          }
+        }
+      } else {
+        stack.push_back({ a + 1, a + 1 });
+        stack.push_back({ x.index, x.index });
+        stack.push_back({ a + 1, x.index });
+      }
+      continue;
+    }
+    if (!x.box.overlaps(y.box)) {
+      continue;
+    }
+    if (x.count && y.count) {
+      for (uint32_t i = x.index; i < x.index + x.count; ++i) {
+        for (uint32_t j = y.index; j < y.index + y.count; ++j) {
+          report(order[i], order[j]);
+        }
+      }
+    } else if (y.count || (!x.count && x.box.area() >= y.box.area())) {
+      // split the larger inner node
+      stack.push_back({ a + 1, b });
+      stack.push_back({ x.index, b });
+    } else {
+      stack.push_back({ a, b + 1 });
+      stack.push_back({ a, y.index });
+    }
+  }
+}
@@ -1,54 +1,330 @@
 #pragma once
 
 #include "vec.h"
+#include "predicates.h"
+#include "quickhull.h"
+#include <stddef.h>
+#include <cstdint>
 #include <algorithm>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 // static class for doing convex hull operations
+// 2D hulls are CCW without collinear points, starting at the leftmost point (lowest on ties)
+// orientation tests use the exact predicates in predicates.h
 template<class T, dim_t D>
 struct ConvexHull {
-  // returns CCW convex hull
-  static std::vector<Vec<T, D>> calc(std::vector<Vec<T, D>> &&pts) {
+  enum Mode {
+    MonotoneChain, // Andrew's monotone chain, O(n log n)
+    Parallel, // each thread hulls a chunk of the points, then the chunk hulls are merged
+    OutputSensitive // Chan's algorithm, O(n log h) for a hull with h points
+  };
+
+  // scratch memory reused between calls (keep one per thread, not thread-safe itself)
+  struct Workspace {
+    size_t threads = 0; // threads used by Parallel (0 for hardware concurrency)
+
+    std::vector<Vec<T, D>> sorted;
+    std::vector<std::vector<Vec<T, D>>> chunks; // per-thread hulls (Parallel)
+    std::vector<Vec<T, D>> group_hulls; // concatenated group hulls (OutputSensitive)
+    std::vector<size_t> group_starts;
+  };
+
+  // returns CCW convex hull (D == 2) or the hull vertices (D >= 3, see Quickhull for facets)
+  static std::vector<Vec<T, D>> calc(std::vector<Vec<T, D>> &&pts, Mode mode = MonotoneChain) {
     static_assert(D >= 2);
-    if constexpr (std::is_same_v<D, 2>) {
+    if constexpr (D == 2) {
       // 2D convex hull
-      convex_hull_2d(pts);
+      Workspace ws;
+      std::vector<Vec<T, D>> res;
+      convex_hull_2d(pts, res, ws, mode);
+      return res;
     } else {
       // ND convex hull
-      convex_hull_nd(pts);
+      Polytope<T, D> res;
+      convex_hull_nd(pts, res, mode);
+      return std::move(res.vertices);
     }
-    return pts;
   }
 
-  static std::vector<Vec<T, D>> calc(const std::vector<Vec<T, D>> &pts) {
+  static std::vector<Vec<T, D>> calc(const std::vector<Vec<T, D>> &pts, Mode mode = MonotoneChain) {
     std::vector<Vec<T, D>> copy = pts;
-    return calc(std::move(copy));
+    return calc(std::move(copy), mode);
+  }
+
+  // writes hull into out, reusing memory of out and ws (no allocations once they are large enough)
+  static void calc(const std::vector<Vec<T, D>> &pts, std::vector<Vec<T, D>> &out, Workspace &ws, Mode mode = MonotoneChain) {
+    static_assert(D == 2);
+    convex_hull_2d(pts, out, ws, mode);
   }
 private:
-  static void convex_hull_2d(std::vector<Vec<T, D>> &pts) {
-    std::vector<T> angles;
-    angles.reserve(pts.size());
-    for (Vec<T, D> &p : pts) {
-      angles.push_back(p.angle());
+  // type squared distances are computed in (wide enough to be exact for integers)
+#ifdef __SIZEOF_INT128__
+  using Wide = std::conditional_t<!std::is_integral_v<T>, T, std::conditional_t<(sizeof(T) <= 4), int64_t, __int128>>;
+#else
+  using Wide = std::conditional_t<!std::is_integral_v<T>, T, int64_t>;
+#endif
+
+  // inputs smaller than this are not worth splitting across threads
+  static constexpr size_t min_parallel_size = 1 << 16;
+
+  static Wide dist_sqd(const Vec<T, D> &a, const Vec<T, D> &b) {
+    Wide dx = Wide(b[0]) - a[0];
+    Wide dy = Wide(b[1]) - a[1];
+    return dx * dx + dy * dy;
+  }
+
+  static bool less_xy(const Vec<T, D> &a, const Vec<T, D> &b) {
+    return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+  }
+
+  static void convex_hull_2d(const std::vector<Vec<T, D>> &pts, std::vector<Vec<T, D>> &out, Workspace &ws, Mode mode) {
+    out.clear();
+    if (mode == Parallel && pts.size() >= min_parallel_size) {
+      parallel_chain(pts, out, ws);
+    } else if (mode == OutputSensitive) {
+      chan(pts, out, ws);
+    } else {
+      ws.sorted.assign(pts.begin(), pts.end());
+      monotone_chain(ws.sorted, out);
+    }
+  }
+
+  // hull of pts (reordered in place) appended to out
+  static void monotone_chain(std::vector<Vec<T, D>> &pts, std::vector<Vec<T, D>> &out) {
+    std::sort(pts.begin(), pts.end(), less_xy);
+    monotone_chain_sorted(pts.data(), pts.size(), out);
+  }
+
+  // hull of n points sorted by x then y, appended to out
+  static void monotone_chain_sorted(const Vec<T, D> *pts, size_t n, std::vector<Vec<T, D>> &out) {
+    size_t base = out.size();
+    if (n == 0) {
+      return;
+    }
+    // lower hull left to right, then upper hull right to left
+    for (size_t i = 0; i < n; ++i) {
+      while (out.size() >= base + 2 && orient2d(out[out.size() - 2], out.back(), pts[i]) <= 0) {
+        out.pop_back();
+      }
+      out.push_back(pts[i]);
+    }
+    if (out.size() - base <= 2 && out[base] == out.back()) {
+      // all points are equal
+      out.resize(base + 1);
+      return;
+    }
+    size_t lower = out.size();
+    for (size_t i = n - 1; i-- > 0;) {
+      while (out.size() >= lower + 1 && orient2d(out[out.size() - 2], out.back(), pts[i]) <= 0) {
+        out.pop_back();
+      }
+      out.push_back(pts[i]);
+    }
+    out.pop_back(); // first point repeated at the end
+  }
+
+  static void parallel_chain(const std::vector<Vec<T, D>> &pts, std::vector<Vec<T, D>> &out, Workspace &ws) {
+    size_t threads = ws.threads != 0 ? ws.threads : std::thread::hardware_concurrency();
+    threads = std::min<size_t>(threads, pts.size() / (min_parallel_size / 4));
+    if (threads <= 1) {
+      ws.sorted.assign(pts.begin(), pts.end());
+      monotone_chain(ws.sorted, out);
+      return;
+    }
+    ws.chunks.resize(threads);
+    size_t chunk_size = (pts.size() + threads - 1) / threads;
+
+    // chunk i sorts its points into the front of its buffer, then appends its hull after them
+    auto hull_chunk = [&](size_t i) {
+      std::vector<Vec<T, D>> &chunk = ws.chunks[i];
+      size_t first = std::min(pts.size(), i * chunk_size);
+      size_t last = std::min(pts.size(), first + chunk_size);
+      chunk.assign(pts.begin() + first, pts.begin() + last);
+      std::sort(chunk.begin(), chunk.end(), less_xy);
+      size_t n = chunk.size();
+      chunk.reserve(2 * n + 1);
+      monotone_chain_sorted(chunk.data(), n, chunk);
+      chunk.erase(chunk.begin(), chunk.begin() + n);
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+      workers.emplace_back(hull_chunk, i);
+    }
+    hull_chunk(0);
+    for (std::thread &worker : workers) {
+      worker.join();
     }
-    std::vector<int> order(pts.size());
-    std::iota(order.begin(), order.end(), 0);
-    std::sort(order.begin(), order.end(), [&](int i, int j) {
-      return angles[i] < angles[j];
-    });
 
-    // TODO
-    size_t j = 1;
-    for (size_t i = 1; i < pts.size(); ++i) {
-      size_t a = pts[j-1];
-      size_t b = pts[i];
+    // hull of the union of the chunk hulls is the hull of all points
+    ws.sorted.clear();
+    for (const std::vector<Vec<T, D>> &chunk : ws.chunks) {
+      ws.sorted.insert(ws.sorted.end(), chunk.begin(), chunk.end());
     }
+    monotone_chain(ws.sorted, out);
   }
 
-  static void convex_hull_nd(std::vector<Vec<T, D>> &pts) {
-    // TODO
+  // Chan's algorithm: guesses hull size m, hulls groups of m points,
+  // then gift-wraps at most m steps using O(log m) tangent searches on each group hull
+  // (the guess is squared until the wrap closes)
+  static void chan(const std::vector<Vec<T, D>> &pts, std::vector<Vec<T, D>> &out, Workspace &ws) {
+    size_t n = pts.size();
+    if (n <= 2) {
+      ws.sorted.assign(pts.begin(), pts.end());
+      monotone_chain(ws.sorted, out);
+      return;
+    }
+    ws.sorted.assign(pts.begin(), pts.end());
+    for (size_t m = 16;; m = m >= n / m ? n : m * m) {
+      // group hulls are stored back to back (group g is [group_starts[g], group_starts[g + 1]))
+      ws.group_hulls.clear();
+      ws.group_starts.clear();
+      for (size_t first = 0; first < n; first += m) {
+        size_t last = std::min(n, first + m);
+        std::sort(ws.sorted.begin() + first, ws.sorted.begin() + last, less_xy);
+        ws.group_starts.push_back(ws.group_hulls.size());
+        monotone_chain_sorted(ws.sorted.data() + first, last - first, ws.group_hulls);
+      }
+      ws.group_starts.push_back(ws.group_hulls.size());
+      if (wrap(out, ws, m)) {
+        return;
+      }
+      out.clear();
+    }
+  }
+
+  // gift wraps from the leftmost point, giving up after max_steps hull points
+  // returns true if the wrap closed
+  static bool wrap(std::vector<Vec<T, D>> &out, Workspace &ws, size_t max_steps) {
+    const std::vector<Vec<T, D>> &hulls = ws.group_hulls;
+    size_t groups = ws.group_starts.size() - 1;
+
+    // every group hull starts at its leftmost point
+    size_t start = 0;
+    for (size_t g = 1; g < groups; ++g) {
+      if (less_xy(hulls[ws.group_starts[g]], hulls[start])) {
+        start = ws.group_starts[g];
+      }
+    }
+    size_t curr = start;
+    while (out.size() < max_steps) {
+      out.push_back(hulls[curr]);
+      const Vec<T, D> &p = hulls[curr];
+
+      // most clockwise candidate over all groups (farthest on ties)
+      size_t best = curr;
+      for (size_t g = 0; g < groups; ++g) {
+        size_t first = ws.group_starts[g];
+        size_t count = ws.group_starts[g + 1] - first;
+        size_t q;
+        if (curr >= first && curr < first + count) {
+          q = first + (curr - first + 1) % count; // successor within its own hull
+        } else {
+          q = first + tangent(hulls.data() + first, count, p);
+        }
+        if (hulls[q] == p) {
+          continue;
+        }
+        int turn = best == curr ? -1 : orient2d(p, hulls[best], hulls[q]);
+        if (turn < 0 || (turn == 0 && dist_sqd(p, hulls[q]) > dist_sqd(p, hulls[best]))) {
+          best = q;
+        }
+      }
+      if (best == curr || hulls[best] == hulls[start]) {
+        return true;
+      }
+      curr = best;
+    }
+    return false;
+  }
+
+  // index of the vertex q of CCW convex polygon poly (m vertices) with no vertex right of p -> q,
+  // the farthest such vertex if several are collinear with p
+  // p must not be inside the polygon
+  static size_t tangent(const Vec<T, D> *poly, size_t m, const Vec<T, D> &p) {
+    if (m <= 3) {
+      return tangent_scan(poly, m, p);
+    }
+    // edge i (poly[i] -> poly[i + 1]) is visible if p is right of it
+    // the visible edges are one cyclic run and q is where that run ends
+    auto next = [m](size_t i) { return i + 1 == m ? 0 : i + 1; };
+    auto visible = [&](size_t i) { return orient2d(p, poly[i], poly[next(i)]) < 0; };
+    // true if poly[i] is strictly clockwise of poly[j] seen from p
+    auto cw_of = [&](size_t i, size_t j) { return orient2d(p, poly[j], poly[i]) < 0; };
+
+    size_t q;
+    bool lo_visible = visible(0);
+    if (visible(m - 1) && !lo_visible) {
+      q = 0;
+    } else {
+      // binary search over the cyclic bitonic sequence of angles around p for the minimum
+      size_t lo = 0, hi = m;
+      while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        bool mid_visible = visible(mid);
+        if (!mid_visible && visible(mid - 1)) {
+          lo = hi = mid;
+          break;
+        }
+        bool go_right;
+        if (lo_visible) {
+          go_right = mid_visible && cw_of(mid, lo);
+        } else {
+          go_right = mid_visible || !cw_of(mid, lo);
+        }
+        if (go_right) {
+          lo = mid;
+          lo_visible = mid_visible;
+        } else {
+          hi = mid;
+        }
+      }
+      q = lo == hi ? lo : next(lo);
+    }
+
+    // confirm the local tangent condition (fall back to a scan if degenerate input fooled the search)
+    size_t prev = q == 0 ? m - 1 : q - 1;
+    if (poly[q] == p || orient2d(p, poly[q], poly[prev]) < 0 || orient2d(p, poly[q], poly[next(q)]) < 0) {
+      return tangent_scan(poly, m, p);
+    }
+    if (orient2d(p, poly[q], poly[next(q)]) == 0 && dist_sqd(p, poly[next(q)]) > dist_sqd(p, poly[q])) {
+      q = next(q);
+    }
+    return q;
+  }
+
+  static size_t tangent_scan(const Vec<T, D> *poly, size_t m, const Vec<T, D> &p) {
+    size_t best = 0;
+    for (size_t i = 1; i < m; ++i) {
+      if (poly[best] == p) {
+        best = i;
+        continue;
+      }
+      if (poly[i] == p) {
+        continue;
+      }
+      int turn = orient2d(p, poly[best], poly[i]);
+      if (turn < 0 || (turn == 0 && dist_sqd(p, poly[i]) > dist_sqd(p, poly[best]))) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  static void convex_hull_nd(const std::vector<Vec<T, D>> &pts, Polytope<T, D> &res, Mode mode) {
+    Quickhull<T, D> hull;
+    if (mode == Parallel) {
+      hull.calc_parallel(pts, res);
+    } else {
+      hull.calc(pts, res);
+    }
   }
 };
 
 // shorthands
 template<class T>
-using ConvexHull2D = ConvexHull<T, 2>;
\ No newline at end of file
+using ConvexHull2D = ConvexHull<T, 2>;
@@ -0,0 +1,736 @@
+#pragma once
+
+#include "vec.h"
+#include "predicates.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Online 2D convex hulls
+// IncrementalHull: insertions only, keeps just the hull vertices (amortized O(log n) insert)
+// DynamicHull: insertions and deletions, keeps every point (Overmars-van Leeuwen, O(log^2 n) expected update)
+// both answer containment and tangent queries in O(log n) and list the hull in the same order as ConvexHull:
+// CCW without collinear points, starting at the leftmost point (lowest on ties)
+// orientation tests use the exact predicates in predicates.h
+
+namespace hull_detail {
+#ifdef __SIZEOF_INT128__
+  template<class T>
+  using Wide = std::conditional_t<std::is_integral_v<T>, __int128, T>;
+#else
+  template<class T>
+  using Wide = std::conditional_t<std::is_integral_v<T>, int64_t, T>;
+#endif
+
+  template<class T>
+  Wide<T> dist_sqd(const Vec2<T> &a, const Vec2<T> &b) {
+    Wide<T> dx = Wide<T>(b[0]) - a[0];
+    Wide<T> dy = Wide<T>(b[1]) - a[1];
+    return dx * dx + dy * dy;
+  }
+
+  // order of points along a hull chain, both chains run clockwise:
+  // the upper chain in (x, y) order, the lower chain in reverse
+  template<bool Lower, class T>
+  bool before(const Vec2<T> &a, const Vec2<T> &b) {
+    if constexpr (Lower) {
+      return b[0] < a[0] || (b[0] == a[0] && b[1] < a[1]);
+    } else {
+      return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+    }
+  }
+
+  // candidate tangent points found on one chain for a query point p
+  // seen from p, a clockwise chain turns one way up to p's position along the chain and the other way after it,
+  // so the angular extremes of each half are its ends or the first edge where the turn changes
+  template<class T>
+  struct Candidates {
+    std::array<Vec2<T>, 12> pts;
+    size_t size = 0;
+
+    void add(const Vec2<T> &p) { pts[size++] = p; }
+  };
+
+  // picks the tangent points from p (outside the hull) among the candidates
+  // left has the hull on the right of the ray from p through it, right has it on the left (nearest on ties)
+  template<class T>
+  void pick_tangents(const Vec2<T> &p, const Candidates<T> &cands, Vec2<T> &left, Vec2<T> &right) {
+    left = right = cands.pts[0];
+    for (size_t i = 1; i < cands.size; ++i) {
+      const Vec2<T> &c = cands.pts[i];
+      int l = orient2d(p, left, c);
+      if (l > 0 || (l == 0 && dist_sqd(p, c) < dist_sqd(p, left))) {
+        left = c;
+      }
+      int r = orient2d(p, right, c);
+      if (r < 0 || (r == 0 && dist_sqd(p, c) < dist_sqd(p, right))) {
+        right = c;
+      }
+    }
+  }
+
+  // removes collinear points from a clockwise chain
+  template<class T>
+  void strip_collinear(std::vector<Vec2<T>> &chain) {
+    size_t n = 0;
+    for (const Vec2<T> &p : chain) {
+      while (n >= 2 && orient2d(chain[n - 2], chain[n - 1], p) >= 0) {
+        --n;
+      }
+      chain[n++] = p;
+    }
+    chain.resize(n);
+  }
+
+  // joins clockwise upper (first to last) and lower (last to first) chains into a CCW hull from the first point
+  template<class T>
+  void join_chains(const std::vector<Vec2<T>> &upper, const std::vector<Vec2<T>> &lower, std::vector<Vec2<T>> &res) {
+    res.assign(lower.rbegin(), lower.rend());
+    if (upper.size() > 2) {
+      res.insert(res.end(), upper.rbegin() + 1, upper.rend() - 1);
+    }
+  }
+}
+
+// Insertion-only hull, interior points are discarded as they arrive
+// each chain is a std::set of vertices that also know their successor, so predicates on edges
+// can be binary searched with lower_bound (the chains stay partitioned by them)
+
+// T: numerical type (int, float, etc.)
+template<class T>
+class IncrementalHull {
+  template<bool Lower>
+  class Chain {
+    struct Vertex {
+      Vec2<T> p;
+      mutable Vec2<T> next; // successor along the chain (valid if has_next)
+      mutable bool has_next = false;
+    };
+
+    // search key matching the first vertex whose edge satisfies pred
+    template<class F>
+    struct Until {
+      F pred;
+    };
+
+    struct Compare {
+      using is_transparent = void;
+
+      bool operator()(const Vertex &a, const Vertex &b) const { return hull_detail::before<Lower>(a.p, b.p); }
+      bool operator()(const Vertex &a, const Vec2<T> &b) const { return hull_detail::before<Lower>(a.p, b); }
+      bool operator()(const Vec2<T> &a, const Vertex &b) const { return hull_detail::before<Lower>(a, b.p); }
+      template<class F>
+      bool operator()(const Vertex &a, const Until<F> &key) const { return !key.pred(a); }
+    };
+
+    std::set<Vertex, Compare> verts;
+
+    template<class F>
+    auto find_first(F pred) const {
+      return verts.lower_bound(Until<F>{ pred });
+    }
+
+    void link(typename std::set<Vertex, Compare>::iterator it) {
+      auto next = std::next(it);
+      it->has_next = next != verts.end();
+      if (it->has_next) {
+        it->next = next->p;
+      }
+    }
+  public:
+    bool empty() const { return verts.empty(); }
+    size_t size() const { return verts.size(); }
+    void clear() { verts.clear(); }
+
+    // adds q if it lies outside the chain, returns false if the chain did not change
+    bool insert(const Vec2<T> &q) {
+      auto it = verts.lower_bound(q);
+      if (it != verts.end() && it->p == q) {
+        return false;
+      }
+      if (it != verts.begin() && it != verts.end() && orient2d(std::prev(it)->p, it->p, q) <= 0) {
+        return false;
+      }
+      it = verts.insert(it, Vertex{ q, q, false });
+      // drop neighbours that no longer turn clockwise
+      auto next = std::next(it);
+      while (next != verts.end() && std::next(next) != verts.end() && orient2d(q, next->p, std::next(next)->p) >= 0) {
+        next = verts.erase(next);
+      }
+      while (it != verts.begin() && std::prev(it) != verts.begin() && orient2d(std::prev(std::prev(it))->p, std::prev(it)->p, q) >= 0) {
+        verts.erase(std::prev(it));
+      }
+      link(it);
+      if (it != verts.begin()) {
+        link(std::prev(it));
+      }
+      return true;
+    }
+
+    // true if q is on or inside the chain (between its ends and on its inner side)
+    bool inside(const Vec2<T> &q) const {
+      auto it = verts.lower_bound(q);
+      if (it != verts.end() && it->p == q) {
+        return true;
+      }
+      if (it == verts.begin() || it == verts.end()) {
+        return false;
+      }
+      return orient2d(std::prev(it)->p, it->p, q) <= 0;
+    }
+
+    void candidates(const Vec2<T> &q, hull_detail::Candidates<T> &res) const {
+      res.add(verts.begin()->p);
+      res.add(std::prev(verts.end())->p);
+      auto it = verts.lower_bound(q);
+      if (it != verts.end()) {
+        res.add(it->p);
+      }
+      if (it != verts.begin()) {
+        res.add(std::prev(it)->p);
+      }
+      // before q: q moves from below to above the edge lines
+      auto pre = find_first([&](const Vertex &v) {
+        return !v.has_next || hull_detail::before<Lower>(q, v.next) || orient2d(v.p, v.next, q) > 0;
+      });
+      if (pre != verts.end()) {
+        res.add(pre->p);
+      }
+      // after q: q moves from above to below the edge lines
+      auto post = find_first([&](const Vertex &v) {
+        return !hull_detail::before<Lower>(v.p, q) && (!v.has_next || orient2d(v.p, v.next, q) <= 0);
+      });
+      if (post != verts.end()) {
+        res.add(post->p);
+      }
+    }
+
+    void append(std::vector<Vec2<T>> &res) const {
+      for (const Vertex &v : verts) {
+        res.push_back(v.p);
+      }
+    }
+  };
+
+  Chain<false> upper;
+  Chain<true> lower;
+public:
+  // adds a point, returns true if it changed the hull
+  bool insert(const Vec2<T> &p) {
+    bool changed = upper.insert(p);
+    changed |= lower.insert(p);
+    return changed;
+  }
+
+  bool empty() const { return upper.empty(); }
+  void clear() {
+    upper.clear();
+    lower.clear();
+  }
+
+  // true if p is inside or on the hull
+  bool contains(const Vec2<T> &p) const {
+    return !empty() && upper.inside(p) && lower.inside(p);
+  }
+
+  // hull vertices touched by the two tangent lines through p (see hull_detail::pick_tangents)
+  // returns false if the hull is empty or contains p
+  bool tangents(const Vec2<T> &p, Vec2<T> &left, Vec2<T> &right) const {
+    if (contains(p) || empty()) {
+      return false;
+    }
+    hull_detail::Candidates<T> cands;
+    upper.candidates(p, cands);
+    lower.candidates(p, cands);
+    hull_detail::pick_tangents(p, cands, left, right);
+    return true;
+  }
+
+  // hull vertices (CCW, starting at the leftmost point)
+  std::vector<Vec2<T>> points() const {
+    std::vector<Vec2<T>> up, down, res;
+    upper.append(up);
+    lower.append(down);
+    hull_detail::join_chains(up, down, res);
+    return res;
+  }
+  // number of hull vertices
+  size_t size() const {
+    return empty() ? 0 : upper.size() + lower.size() - (upper.size() == 1 ? 1 : 2);
+  }
+};
+
+// Fully dynamic hull (Overmars-van Leeuwen with implicit subhulls)
+// points are the leaves of a treap ordered by (x, y), every internal node stores the bridges (edges)
+// joining the upper and lower hulls of its two children, the hull of a subtree is then the first child's
+// hull up to the bridge followed by the second child's hull after it, so nothing but the bridges is stored
+// bridges are found by descending both children at once, an update recomputes the bridges on its path
+
+// T: numerical type (int, float, etc.)
+template<class T>
+class DynamicHull {
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  struct Node {
+    uint32_t left = none, right = none, parent = none; // leaves have no children
+    uint32_t priority = 0;
+    Vec2<T> lo, hi; // smallest and largest point in the subtree (the point itself for leaves)
+    Vec2<T> bridge[2][2]; // [upper, lower][from, to], ends of the bridge in chain order (copied to save a lookup)
+  };
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> free_nodes;
+  uint32_t root = none;
+  size_t count = 0;
+  uint32_t seed = 0x9e3779b9;
+public:
+  size_t size() const { return count; } // number of points stored (not hull vertices)
+  bool empty() const { return count == 0; }
+  void clear() {
+    nodes.clear();
+    free_nodes.clear();
+    root = none;
+    count = 0;
+  }
+
+  // adds a point, returns false if it is already stored
+  bool insert(const Vec2<T> &p) {
+    if (root == none) {
+      root = new_leaf(p);
+      count = 1;
+      return true;
+    }
+    uint32_t leaf = find_leaf(p);
+    if (nodes[leaf].lo == p) {
+      return false;
+    }
+    uint32_t added = new_leaf(p);
+    uint32_t node = alloc();
+    uint32_t parent = nodes[leaf].parent;
+    nodes[node].priority = next_priority();
+    bool first = hull_detail::before<false>(p, nodes[leaf].lo);
+    set_child(node, first ? added : leaf, first ? leaf : added);
+    replace(parent, leaf, node);
+    // restore heap order of priorities (node's own bridges wait until its children are final)
+    while (nodes[node].parent != none && nodes[nodes[node].parent].priority < nodes[node].priority) {
+      rotate_up(node);
+    }
+    pull(node);
+    // subtrees whose chains do not use p kept their hulls, and so did everything above them
+    bool upper = on_chain<false>(node, p), lower = on_chain<true>(node, p);
+    while ((upper || lower) && nodes[node].parent != none) {
+      uint32_t child = node;
+      node = nodes[node].parent;
+      pull(node);
+      upper = upper && keeps<false>(node, child, p);
+      lower = lower && keeps<true>(node, child, p);
+    }
+    ++count;
+    return true;
+  }
+
+  // removes a point, returns false if it is not stored
+  bool erase(const Vec2<T> &p) {
+    if (root == none) {
+      return false;
+    }
+    uint32_t leaf = find_leaf(p);
+    if (nodes[leaf].lo != p) {
+      return false;
+    }
+    uint32_t node = nodes[leaf].parent;
+    free_nodes.push_back(leaf);
+    --count;
+    if (node == none) {
+      root = none;
+      return true;
+    }
+    // only the subtrees whose chains use p change
+    uint32_t stop = node, child = leaf;
+    bool upper = true, lower = true;
+    while (stop != none) {
+      upper = upper && keeps<false>(stop, child, p);
+      lower = lower && keeps<true>(stop, child, p);
+      if (!upper && !lower) {
+        break;
+      }
+      child = stop;
+      stop = nodes[stop].parent;
+    }
+    uint32_t sibling = nodes[node].left == leaf ? nodes[node].right : nodes[node].left;
+    uint32_t parent = nodes[node].parent;
+    replace(parent, node, sibling);
+    free_nodes.push_back(node);
+    if (stop != node) {
+      for (uint32_t n = parent; n != stop; n = nodes[n].parent) {
+        pull(n);
+      }
+    }
+    return true;
+  }
+
+  // true if p is inside or on the hull
+  bool contains(const Vec2<T> &p) const {
+    if (root == none) {
+      return false;
+    }
+    if (leaf(root)) {
+      return nodes[root].lo == p;
+    }
+    if (hull_detail::before<false>(p, nodes[root].lo) || hull_detail::before<false>(nodes[root].hi, p)) {
+      return false;
+    }
+    return inside<false>(p) && inside<true>(p);
+  }
+
+  // hull vertices touched by the two tangent lines through p (see hull_detail::pick_tangents)
+  // returns false if the hull is empty or contains p
+  bool tangents(const Vec2<T> &p, Vec2<T> &left, Vec2<T> &right) const {
+    if (contains(p) || root == none) {
+      return false;
+    }
+    if (leaf(root)) {
+      left = right = nodes[root].lo;
+      return true;
+    }
+    hull_detail::Candidates<T> cands;
+    candidates<false>(p, cands);
+    candidates<true>(p, cands);
+    hull_detail::pick_tangents(p, cands, left, right);
+    return true;
+  }
+
+  // hull vertices (CCW, starting at the leftmost point), O(h log n) for h hull vertices
+  std::vector<Vec2<T>> points() const {
+    std::vector<Vec2<T>> up, down, res;
+    if (root == none) {
+      return res;
+    }
+    if (leaf(root)) {
+      res.push_back(nodes[root].lo);
+      return res;
+    }
+    append<false>(root, nullptr, nullptr, up);
+    append<true>(root, nullptr, nullptr, down);
+    hull_detail::strip_collinear(up);
+    hull_detail::strip_collinear(down);
+    hull_detail::join_chains(up, down, res);
+    return res;
+  }
+private:
+  bool leaf(uint32_t n) const { return nodes[n].left == none; }
+  const Vec2<T> &pt(uint32_t leaf) const { return nodes[leaf].lo; }
+
+  // children in chain order (the lower chain runs right to left)
+  template<bool Lower>
+  uint32_t first(uint32_t n) const { return Lower ? nodes[n].right : nodes[n].left; }
+  template<bool Lower>
+  uint32_t second(uint32_t n) const { return Lower ? nodes[n].left : nodes[n].right; }
+  template<bool Lower>
+  const Vec2<T> &chain_front(uint32_t n) const { return Lower ? nodes[n].hi : nodes[n].lo; }
+
+  uint32_t alloc() {
+    uint32_t n;
+    if (!free_nodes.empty()) {
+      n = free_nodes.back();
+      free_nodes.pop_back();
+      nodes[n] = Node();
+    } else {
+      n = nodes.size();
+      nodes.emplace_back();
+    }
+    return n;
+  }
+
+  uint32_t new_leaf(const Vec2<T> &p) {
+    uint32_t n = alloc();
+    nodes[n].lo = nodes[n].hi = p;
+    return n;
+  }
+
+  uint32_t next_priority() {
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  uint32_t find_leaf(const Vec2<T> &p) const {
+    uint32_t n = root;
+    while (!leaf(n)) {
+      n = hull_detail::before<false>(nodes[nodes[n].left].hi, p) ? nodes[n].right : nodes[n].left;
+    }
+    return n;
+  }
+
+  void set_child(uint32_t n, uint32_t left, uint32_t right) {
+    nodes[n].left = left;
+    nodes[n].right = right;
+    nodes[left].parent = n;
+    nodes[right].parent = n;
+  }
+
+  // puts child in place of old under parent (or as root)
+  void replace(uint32_t parent, uint32_t old, uint32_t child) {
+    nodes[child].parent = parent;
+    if (parent == none) {
+      root = child;
+    } else if (nodes[parent].left == old) {
+      nodes[parent].left = child;
+    } else {
+      nodes[parent].right = child;
+    }
+  }
+
+  // moves n above its parent, the parent is updated but n is not
+  void rotate_up(uint32_t n) {
+    uint32_t parent = nodes[n].parent;
+    replace(nodes[parent].parent, parent, n);
+    if (nodes[parent].left == n) {
+      set_child(parent, nodes[n].right, nodes[parent].right);
+      set_child(n, nodes[n].left, parent);
+    } else {
+      set_child(parent, nodes[parent].left, nodes[n].left);
+      set_child(n, parent, nodes[n].right);
+    }
+    pull(parent);
+  }
+
+  void pull(uint32_t n) {
+    nodes[n].lo = nodes[nodes[n].left].lo;
+    nodes[n].hi = nodes[nodes[n].right].hi;
+    find_bridge<false>(n);
+    find_bridge<true>(n);
+  }
+
+  // true if p is a vertex of the chain of n as stored (bridges may end on collinear points)
+  template<bool Lower>
+  bool on_chain(uint32_t n, const Vec2<T> &p) const {
+    Vec2<T> a, b;
+    if (!find_edge<Lower>(n, [&](const Vec2<T> &, const Vec2<T> &to) { return !hull_detail::before<Lower>(to, p); }, a, b)) {
+      return false;
+    }
+    return a == p || b == p;
+  }
+
+  // true if the chain of n keeps the part of the chain of child (a child of n) that holds p
+  template<bool Lower>
+  bool keeps(uint32_t n, uint32_t child, const Vec2<T> &p) const {
+    const Vec2<T> *e = nodes[n].bridge[Lower];
+    if (child == first<Lower>(n)) {
+      return !hull_detail::before<Lower>(e[0], p);
+    }
+    return !hull_detail::before<Lower>(p, e[1]);
+  }
+
+  // descends x in the first child and y in the second until both are the bridge's leaves
+  // each subtree hull only matches the child hull between the bounds found so far, bridges outside them are skipped
+  // with a, b the edge at x and c, d the edge at y:
+  //   c above line ab: the bridge starts at or before a
+  //   b above line cd: the bridge ends at or after d
+  //   otherwise it starts at or after b or ends at or before c, depending on which side of the
+  //   second child's first point lines ab and cd cross
+  template<bool Lower>
+  void find_bridge(uint32_t n) {
+    using hull_detail::before;
+    uint32_t x = first<Lower>(n), y = second<Lower>(n);
+    const Vec2<T> *x_lo = nullptr, *x_hi = nullptr, *y_lo = nullptr, *y_hi = nullptr;
+    while (!leaf(x) || !leaf(y)) {
+      if (!leaf(x)) {
+        const Vec2<T> *e = nodes[x].bridge[Lower];
+        if (x_lo && !before<Lower>(*x_lo, e[1])) {
+          x = second<Lower>(x);
+          continue;
+        }
+        if (x_hi && !before<Lower>(e[0], *x_hi)) {
+          x = first<Lower>(x);
+          continue;
+        }
+      }
+      if (!leaf(y)) {
+        const Vec2<T> *e = nodes[y].bridge[Lower];
+        if (y_lo && !before<Lower>(*y_lo, e[1])) {
+          y = second<Lower>(y);
+          continue;
+        }
+        if (y_hi && !before<Lower>(e[0], *y_hi)) {
+          y = first<Lower>(y);
+          continue;
+        }
+      }
+      const Vec2<T> &a = leaf(x) ? pt(x) : nodes[x].bridge[Lower][0];
+      const Vec2<T> &b = leaf(x) ? pt(x) : nodes[x].bridge[Lower][1];
+      const Vec2<T> &c = leaf(y) ? pt(y) : nodes[y].bridge[Lower][0];
+      const Vec2<T> &d = leaf(y) ? pt(y) : nodes[y].bridge[Lower][1];
+      if (!leaf(x) && orient2d(a, b, c) > 0) {
+        x_hi = &a;
+        x = first<Lower>(x);
+        continue;
+      }
+      if (!leaf(y) && orient2d(c, d, b) > 0) {
+        y_lo = &d;
+        y = second<Lower>(y);
+        continue;
+      }
+      bool left_x;
+      if (leaf(x)) {
+        left_x = false;
+      } else if (leaf(y)) {
+        left_x = true;
+      } else {
+        left_x = crosses_before<Lower>(a, b, c, d, chain_front<Lower>(second<Lower>(n)));
+      }
+      if (left_x) {
+        x_lo = &b;
+        x = second<Lower>(x);
+      } else {
+        y_hi = &c;
+        y = first<Lower>(y);
+      }
+    }
+    nodes[n].bridge[Lower][0] = pt(x);
+    nodes[n].bridge[Lower][1] = pt(y);
+  }
+
+  // true if lines ab and cd cross before point m in chain order (false for parallel lines)
+  template<bool Lower>
+  static bool crosses_before(const Vec2<T> &a, const Vec2<T> &b, const Vec2<T> &c, const Vec2<T> &d, const Vec2<T> &m) {
+    // intersection is a + (b - a) * num / den, sx and sy are the signs of the intersection minus m
+    int sx, sy;
+    if constexpr (predicates_detail::small_int<T>) {
+      using W = predicates_detail::Wide;
+      W den = (W(b[0]) - a[0]) * (W(d[1]) - c[1]) - (W(b[1]) - a[1]) * (W(d[0]) - c[0]);
+      if (den == 0) {
+        return false;
+      }
+      W num = (W(c[0]) - a[0]) * (W(d[1]) - c[1]) - (W(c[1]) - a[1]) * (W(d[0]) - c[0]);
+      int sign = den > 0 ? 1 : -1;
+      W dx = (W(a[0]) - m[0]) * den + num * (W(b[0]) - a[0]);
+      W dy = (W(a[1]) - m[1]) * den + num * (W(b[1]) - a[1]);
+      sx = dx == 0 ? 0 : (dx > 0 ? sign : -sign);
+      sy = dy == 0 ? 0 : (dy > 0 ? sign : -sign);
+    } else {
+      // same terms in double behind error bound filters, with exact expansions when the filters fail
+      using namespace predicates_detail;
+      double dcx = double(d[0]) - double(c[0]), dcy = double(d[1]) - double(c[1]);
+      double den_l = (double(b[0]) - double(a[0])) * dcy, den_r = (double(b[1]) - double(a[1])) * dcx;
+      double num_l = (double(c[0]) - double(a[0])) * dcy, num_r = (double(c[1]) - double(a[1])) * dcx;
+      double den = den_l - den_r, num = num_l - num_r;
+      auto exact_den = [&]() { return diff(b[0], a[0]) * diff(d[1], c[1]) - diff(b[1], a[1]) * diff(d[0], c[0]); };
+      auto exact_num = [&]() { return diff(c[0], a[0]) * diff(d[1], c[1]) - diff(c[1], a[1]) * diff(d[0], c[0]); };
+      int den_sign = std::abs(den) >= ccw_bound * (std::abs(den_l) + std::abs(den_r)) ? sign(den) : exact_den().sign();
+      if (den_sign == 0) {
+        return false;
+      }
+      // same shape as an orient3d minor expansion, so its error bound applies
+      auto coord_sign = [&](size_t i) {
+        double am = double(a[i]) - double(m[i]), ba = double(b[i]) - double(a[i]);
+        double det = am * den + num * ba;
+        double permanent = std::abs(am) * (std::abs(den_l) + std::abs(den_r)) + std::abs(ba) * (std::abs(num_l) + std::abs(num_r));
+        if (std::abs(det) >= o3d_bound * permanent) {
+          return sign(det);
+        }
+        return (diff(a[i], m[i]) * exact_den() + exact_num() * diff(b[i], a[i])).sign();
+      };
+      sx = coord_sign(0) * den_sign;
+      sy = coord_sign(1) * den_sign;
+    }
+    if constexpr (Lower) {
+      return sx > 0 || (sx == 0 && sy > 0);
+    } else {
+      return sx < 0 || (sx == 0 && sy < 0);
+    }
+  }
+
+  // first edge (a, b) of the chain of node n satisfying pred (the chain must be partitioned by pred)
+  template<bool Lower, class F>
+  bool find_edge(uint32_t n, F pred, Vec2<T> &a, Vec2<T> &b) const {
+    using hull_detail::before;
+    const Vec2<T> *lo = nullptr, *hi = nullptr;
+    bool found = false;
+    while (!leaf(n)) {
+      const Vec2<T> *e = nodes[n].bridge[Lower];
+      if (lo && !before<Lower>(*lo, e[1])) {
+        n = second<Lower>(n);
+      } else if (hi && !before<Lower>(e[0], *hi)) {
+        n = first<Lower>(n);
+      } else if (pred(e[0], e[1])) {
+        a = e[0];
+        b = e[1];
+        found = true;
+        hi = &e[0];
+        n = first<Lower>(n);
+      } else {
+        lo = &e[1];
+        n = second<Lower>(n);
+      }
+    }
+    return found;
+  }
+
+  // p must lie between the ends of the chain
+  template<bool Lower>
+  bool inside(const Vec2<T> &p) const {
+    Vec2<T> a, b;
+    if (!find_edge<Lower>(root, [&](const Vec2<T> &, const Vec2<T> &to) { return !hull_detail::before<Lower>(to, p); }, a, b)) {
+      return false;
+    }
+    return orient2d(a, b, p) <= 0;
+  }
+
+  template<bool Lower>
+  void candidates(const Vec2<T> &p, hull_detail::Candidates<T> &res) const {
+    using hull_detail::before;
+    res.add(nodes[root].lo);
+    res.add(nodes[root].hi);
+    Vec2<T> a, b;
+    if (find_edge<Lower>(root, [&](const Vec2<T> &, const Vec2<T> &to) { return !before<Lower>(to, p); }, a, b)) {
+      res.add(a);
+      res.add(b);
+    }
+    // before p: p moves from below to above the edge lines
+    if (find_edge<Lower>(root, [&](const Vec2<T> &from, const Vec2<T> &to) { return before<Lower>(p, to) || orient2d(from, to, p) > 0; }, a, b)) {
+      res.add(a);
+    }
+    // after p: p moves from above to below the edge lines
+    if (find_edge<Lower>(root, [&](const Vec2<T> &from, const Vec2<T> &to) { return !before<Lower>(from, p) && orient2d(from, to, p) <= 0; }, a, b)) {
+      res.add(a);
+    }
+  }
+
+  // appends the vertices of the chain of n that lie between lo and hi (inclusive, null for unbounded)
+  template<bool Lower>
+  void append(uint32_t n, const Vec2<T> *lo, const Vec2<T> *hi, std::vector<Vec2<T>> &res) const {
+    using hull_detail::before;
+    if (leaf(n)) {
+      if ((!lo || !before<Lower>(pt(n), *lo)) && (!hi || !before<Lower>(*hi, pt(n)))) {
+        res.push_back(pt(n));
+      }
+      return;
+    }
+    const Vec2<T> &a = nodes[n].bridge[Lower][0];
+    const Vec2<T> &b = nodes[n].bridge[Lower][1];
+    if (!lo || !before<Lower>(a, *lo)) {
+      append<Lower>(first<Lower>(n), lo, hi && before<Lower>(*hi, a) ? hi : &a, res);
+    }
+    if (!hi || !before<Lower>(*hi, b)) {
+      append<Lower>(second<Lower>(n), lo && before<Lower>(b, *lo) ? lo : &b, hi, res);
+    }
+  }
+};
+
+// shorthands
+using IncrementalHull2i = IncrementalHull<int>;
+using IncrementalHull2f = IncrementalHull<float>;
+using IncrementalHull2d = IncrementalHull<double>;
+using DynamicHull2i = DynamicHull<int>;
+using DynamicHull2f = DynamicHull<float>;
+using DynamicHull2d = DynamicHull<double>;
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "line.h"
+#include "predicates.h"
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+// Implements intersection calcs for primitives (included by line.h)
+
+// static class to implement trivial intersection calculations
+template<class T, dim_t D>
+struct Intersection {
+  // exact type for positions along a line (dot products)
+  using Wide = std::conditional_t<predicates_detail::small_int<T>, predicates_detail::Wide, double>;
+
+  // position of p along base, (p - base.origin) . base.dir
+  template<LineType L>
+  static Wide along(const GenLine<T, D, L> &base, const Vec<T, D> &p) {
+    Wide res = 0;
+    for (size_t i = 0; i < D; ++i) {
+      res += (Wide(p[i]) - Wide(base.origin[i])) * Wide(base.dir[i]);
+    }
+    return res;
+  }
+
+  // part of a line as positions along another (collinear) line, unbounded ends are flagged
+  struct Span {
+    bool bounded[2] = { false, false };
+    Wide s[2] = { 0, 0 };
+    Vec<T, D> at[2];
+
+    void bound(size_t side, Wide val, const Vec<T, D> &p) {
+      bool tighter = side == 0 ? val > s[0] : val < s[1];
+      if (!bounded[side] || tighter) {
+        bounded[side] = true;
+        s[side] = val;
+        at[side] = p;
+      }
+    }
+  };
+
+  template<LineType L1, LineType L2>
+  static void add_span(Span &span, const GenLine<T, D, L1> &base, const GenLine<T, D, L2> &l) {
+    if constexpr (L2 == RayT) {
+      Wide forward = 0;
+      for (size_t i = 0; i < D; ++i) {
+        forward += Wide(l.dir[i]) * Wide(base.dir[i]);
+      }
+      span.bound(forward > 0 ? 0 : 1, along(base, l.origin), l.origin);
+    } else if constexpr (L2 == SegT) {
+      Wide s0 = along(base, l.a()), s1 = along(base, l.b());
+      span.bound(0, std::min(s0, s1), s0 <= s1 ? l.a() : l.b());
+      span.bound(1, std::max(s0, s1), s0 <= s1 ? l.b() : l.a());
+    }
+  }
+
+  // whether p lies on l (within its bounds)
+  template<LineType L>
+  static bool contains(const GenLine<T, D, L> &l, const Vec<T, D> &p) {
+    if (l.dir == Vec<T, D>()) {
+      return p == l.origin;
+    }
+    if (orient2d_dir(l.origin, l.dir, p) != 0) {
+      return false;
+    }
+    Span span;
+    add_span(span, l, l);
+    Wide s = along(l, p);
+    return (!span.bounded[0] || s >= span.s[0]) && (!span.bounded[1] || s <= span.s[1]);
+  }
+
+  // whether the crossing point lies within the bounds of x, given den = x.dir cross y.dir != 0
+  template<LineType L1, LineType L2>
+  static bool in_bounds(const GenLine<T, D, L1> &x, const GenLine<T, D, L2> &y, int den) {
+    if constexpr (L1 == RayT) {
+      return orient2d_dir(y.origin, y.dir, x.origin) * den >= 0;
+    } else if constexpr (L1 == SegT) {
+      return orient2d_dir(y.origin, y.dir, x.a()) * orient2d_dir(y.origin, y.dir, x.b()) <= 0;
+    }
+    return true;
+  }
+
+  // finds intersection point between two lines
+  // topology (none, one point, overlap) is decided with exact predicates, only the point itself is rounded
+  template<LineType L1, LineType L2>
+  static void find_helper(LineIntersectRes<T, D> &res, const GenLine<T, D, L1> &a, const GenLine<T, D, L2> &b) {
+    static_assert(D == 2, "line intersection is only implemented in 2D");
+    int den = orient2d_dir(Vec<T, D>(), a.dir, b.dir);
+    if (den == 0) {
+      // a zero direction is a single point
+      if (b.dir == Vec<T, D>()) {
+        res.type = contains(a, b.origin) ? res.OnePoint : res.None;
+        res.point = b.origin;
+        return;
+      }
+      if (a.dir == Vec<T, D>()) {
+        res.type = contains(b, a.origin) ? res.OnePoint : res.None;
+        res.point = a.origin;
+        return;
+      }
+      // parallel, only collinear lines can meet
+      if (orient2d_dir(a.origin, a.dir, b.origin) != 0) {
+        res.type = res.None;
+        return;
+      }
+      Span span;
+      add_span(span, a, a);
+      add_span(span, a, b);
+      if (span.bounded[0] && span.bounded[1] && span.s[0] >= span.s[1]) {
+        res.type = span.s[0] == span.s[1] ? res.OnePoint : res.None;
+        res.point = span.at[0];
+      } else {
+        res.type = res.Infinite;
+      }
+      return;
+    }
+    if (!in_bounds(a, b, den) || !in_bounds(b, a, -den)) {
+      res.type = res.None;
+      return;
+    }
+    // a(t) with t = ((b.origin - a.origin) cross b.dir) / (a.dir cross b.dir)
+    double ox = double(b.origin[0]) - double(a.origin[0]), oy = double(b.origin[1]) - double(a.origin[1]);
+    double t = (ox * double(b.dir[1]) - oy * double(b.dir[0]))
+      / (double(a.dir[0]) * double(b.dir[1]) - double(a.dir[1]) * double(b.dir[0]));
+    res.type = res.OnePoint;
+    for (size_t i = 0; i < D; ++i) {
+      double x = double(a.origin[i]) + double(a.dir[i]) * t;
+      res.point[i] = std::is_integral_v<T> ? T(std::llround(x)) : T(x);
+    }
+  }
+
+  // finds intersection point between two lines (respecting endpoint bounds)
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, LineT> &a, const GenLine<T, D, LineT> &b) {
+    find_helper<LineT, LineT>(res, a, b);
+  }
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, LineT> &a, const GenLine<T, D, RayT> &b) {
+    find_helper<LineT, RayT>(res, a, b);
+  }
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, LineT> &a, const GenLine<T, D, SegT> &b) {
+    find_helper<LineT, SegT>(res, a, b);
+  }
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, RayT> &a, const GenLine<T, D, RayT> &b) {
+    find_helper<RayT, RayT>(res, a, b);
+  }
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, RayT> &a, const GenLine<T, D, SegT> &b) {
+    find_helper<RayT, SegT>(res, a, b);
+  }
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, SegT> &a, const GenLine<T, D, SegT> &b) {
+    find_helper<SegT, SegT>(res, a, b);
+  }
+
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, RayT> &a, const GenLine<T, D, LineT> &b) { find(res, b, a); }
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, SegT> &a, const GenLine<T, D, LineT> &b) { find(res, b, a); }
+  static void find(LineIntersectRes<T, D> &res, const GenLine<T, D, SegT> &a, const GenLine<T, D, RayT> &b) { find(res, b, a); }
+
+  // return true if intersection exists
+  static bool exists(const GenLine<T, D, LineT> &line, const Circ<T, D> &circ);
+  static bool exists(const GenLine<T, D, LineT> &line, const Rect<T, D> &rect);
+};
+
+template<class T, dim_t D, LineType L>
+template<LineType L2>
+LineIntersectRes<T, D> GenLine<T, D, L>::intersection(const GenLine<T, D, L2> &other) const {
+  LineIntersectRes<T, D> res;
+  Intersection<T, D>::find(res, *this, other);
+  return res;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "vec.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Static kd-tree over a set of points
+// the tree is implicit: points are reordered so the node of a range [lo, hi) is the median at (lo + hi) / 2,
+// with its left subtree in [lo, mid) and its right subtree in (mid, hi), only the split axis is stored per node
+// each node splits along the axis where its points spread the most
+// distances are squared (Vec::mag_sqd), no square roots are taken
+// queries are const and can run concurrently
+
+// T: numerical type (int, float, etc.)
+// D: number of dimensions (D >= 1)
+template<class T, dim_t D>
+class KdTree {
+  static_assert(D >= 1);
+
+  // type approximate searches scale distances in
+  using S = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+public:
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  struct Neighbor {
+    uint32_t id; // index into the points given to build (none if there were fewer points than asked for)
+    T dist_sqd;
+  };
+
+  // builds the tree in O(n log n), the top levels are split across threads (0 for hardware concurrency)
+  void build(const Vec<T, D> *pts, size_t n, size_t threads = 0);
+  void build(const std::vector<Vec<T, D>> &pts, size_t threads = 0) {
+    build(pts.data(), pts.size(), threads);
+  }
+
+  size_t size() const { return points.size(); }
+
+  // k nearest points to q, closest first (fewer if the tree is smaller)
+  // eps > 0 gives an approximate search: every neighbor is within (1 + eps) times the distance of the exact one
+  void knn(const Vec<T, D> &q, size_t k, std::vector<Neighbor> &out, S eps = 0) const;
+
+  // nearest point to q (id none if empty)
+  Neighbor nearest(const Vec<T, D> &q, S eps = 0) const;
+
+  // ids of all points within radius of q (unordered)
+  void radius(const Vec<T, D> &q, T radius, std::vector<uint32_t> &out) const;
+
+  // knn for each of n queries across threads (0 for hardware concurrency)
+  // the neighbors of query i are out[i * k, (i + 1) * k), padded with id none
+  void knn(const Vec<T, D> *qs, size_t n, size_t k, std::vector<Neighbor> &out, S eps = 0, size_t threads = 0) const;
+private:
+  // subtrees smaller than this are built on the current thread
+  static constexpr size_t min_parallel_size = 1 << 14;
+  // queries per thread below which batches are not split
+  static constexpr size_t min_batch_size = 256;
+
+  struct Item {
+    Vec<T, D> p;
+    uint32_t id;
+  };
+
+  std::vector<Vec<T, D>> points; // in tree order
+  std::vector<uint32_t> ids;     // in tree order
+  std::vector<dim_t> axes;       // split axis of the node at each position
+
+  static bool farther(const Neighbor &a, const Neighbor &b) { return a.dist_sqd < b.dist_sqd; }
+
+  static size_t thread_count(size_t threads, size_t work, size_t min_work) {
+    size_t res = threads != 0 ? threads : std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(res, work / min_work));
+  }
+
+  void build_range(std::vector<Item> &items, size_t lo, size_t hi, size_t spawn);
+
+  // heap is a max-heap on distance holding at most k neighbors, scale = 1 / (1 + eps)^2
+  void knn_range(size_t lo, size_t hi, const Vec<T, D> &q, size_t k, std::vector<Neighbor> &heap, S scale) const;
+  void radius_range(size_t lo, size_t hi, const Vec<T, D> &q, T r_sqd, std::vector<uint32_t> &out) const;
+};
+
+template<class T, dim_t D>
+void KdTree<T, D>::build(const Vec<T, D> *pts, size_t n, size_t threads) {
+  std::vector<Item> items(n);
+  for (size_t i = 0; i < n; ++i) {
+    items[i] = { pts[i], uint32_t(i) };
+  }
+  axes.assign(n, 0);
+  // each level of spawning doubles the threads
+  size_t spawn = 0;
+  for (size_t count = thread_count(threads, n, min_parallel_size); count > 1; count = (count + 1) / 2) {
+    ++spawn;
+  }
+  build_range(items, 0, n, spawn);
+  points.resize(n);
+  ids.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    points[i] = items[i].p;
+    ids[i] = items[i].id;
+  }
+}
+
+template<class T, dim_t D>
+void KdTree<T, D>::build_range(std::vector<Item> &items, size_t lo, size_t hi, size_t spawn) {
+  if (hi - lo <= 1) {
+    return;
+  }
+  T min[D], max[D];
+  for (size_t i = 0; i < D; ++i) {
+    min[i] = max[i] = items[lo].p[i];
+  }
+  for (size_t j = lo + 1; j < hi; ++j) {
+    for (size_t i = 0; i < D; ++i) {
+      min[i] = std::min(min[i], items[j].p[i]);
+      max[i] = std::max(max[i], items[j].p[i]);
+    }
+  }
+  dim_t axis = 0;
+  for (dim_t i = 1; i < D; ++i) {
+    if (max[i] - min[i] > max[axis] - min[axis]) {
+      axis = i;
+    }
+  }
+  size_t mid = (lo + hi) / 2;
+  std::nth_element(items.begin() + lo, items.begin() + mid, items.begin() + hi,
+    [axis](const Item &a, const Item &b) { return a.p[axis] < b.p[axis]; });
+  axes[mid] = axis;
+  if (spawn > 0 && hi - lo >= min_parallel_size) {
+    std::thread worker([&]() { build_range(items, lo, mid, spawn - 1); });
+    build_range(items, mid + 1, hi, spawn - 1);
+    worker.join();
+  } else {
+    build_range(items, lo, mid, 0);
+    build_range(items, mid + 1, hi, 0);
+  }
+}
+
+template<class T, dim_t D>
+void KdTree<T, D>::knn_range(size_t lo, size_t hi, const Vec<T, D> &q, size_t k, std::vector<Neighbor> &heap, S scale) const {
+  if (lo >= hi) {
+    return;
+  }
+  size_t mid = (lo + hi) / 2;
+  T dist_sqd = (points[mid] - q).mag_sqd();
+  if (heap.size() < k) {
+    heap.push_back({ ids[mid], dist_sqd });
+    std::push_heap(heap.begin(), heap.end(), farther);
+  } else if (dist_sqd < heap.front().dist_sqd) {
+    std::pop_heap(heap.begin(), heap.end(), farther);
+    heap.back() = { ids[mid], dist_sqd };
+    std::push_heap(heap.begin(), heap.end(), farther);
+  }
+  if (hi - lo == 1) {
+    return;
+  }
+  dim_t axis = axes[mid];
+  T diff = q[axis] - points[mid][axis];
+  // nearer side first, the other side only if the splitting plane is closer than the current k-th neighbor
+  if (diff < 0) {
+    knn_range(lo, mid, q, k, heap, scale);
+  } else {
+    knn_range(mid + 1, hi, q, k, heap, scale);
+  }
+  if (heap.size() < k || S(diff * diff) < S(heap.front().dist_sqd) * scale) {
+    if (diff < 0) {
+      knn_range(mid + 1, hi, q, k, heap, scale);
+    } else {
+      knn_range(lo, mid, q, k, heap, scale);
+    }
+  }
+}
+
+template<class T, dim_t D>
+void KdTree<T, D>::knn(const Vec<T, D> &q, size_t k, std::vector<Neighbor> &out, S eps) const {
+  out.clear();
+  if (k == 0) {
+    return;
+  }
+  out.reserve(std::min(k, points.size()));
+  knn_range(0, points.size(), q, k, out, S(1) / ((1 + eps) * (1 + eps)));
+  std::sort_heap(out.begin(), out.end(), farther);
+}
+
+template<class T, dim_t D>
+typename KdTree<T, D>::Neighbor KdTree<T, D>::nearest(const Vec<T, D> &q, S eps) const {
+  std::vector<Neighbor> res;
+  knn(q, 1, res, eps);
+  return res.empty() ? Neighbor{ none, std::numeric_limits<T>::max() } : res[0];
+}
+
+template<class T, dim_t D>
+void KdTree<T, D>::radius_range(size_t lo, size_t hi, const Vec<T, D> &q, T r_sqd, std::vector<uint32_t> &out) const {
+  if (lo >= hi) {
+    return;
+  }
+  size_t mid = (lo + hi) / 2;
+  if ((points[mid] - q).mag_sqd() <= r_sqd) {
+    out.push_back(ids[mid]);
+  }
+  if (hi - lo == 1) {
+    return;
+  }
+  T diff = q[axes[mid]] - points[mid][axes[mid]];
+  bool both = diff * diff <= r_sqd;
+  if (diff < 0 || both) {
+    radius_range(lo, mid, q, r_sqd, out);
+  }
+  if (diff >= 0 || both) {
+    radius_range(mid + 1, hi, q, r_sqd, out);
+  }
+}
+
+template<class T, dim_t D>
+void KdTree<T, D>::radius(const Vec<T, D> &q, T radius, std::vector<uint32_t> &out) const {
+  out.clear();
+  radius_range(0, points.size(), q, radius * radius, out);
+}
+
+template<class T, dim_t D>
+void KdTree<T, D>::knn(const Vec<T, D> *qs, size_t n, size_t k, std::vector<Neighbor> &out, S eps, size_t threads) const {
+  out.assign(n * k, Neighbor{ none, std::numeric_limits<T>::max() });
+  size_t count = thread_count(threads, n, min_batch_size);
+  size_t chunk_size = (n + count - 1) / count;
+  auto run = [&](size_t t) {
+    std::vector<Neighbor> res;
+    for (size_t i = t * chunk_size; i < std::min(n, (t + 1) * chunk_size); ++i) {
+      knn(qs[i], k, res, eps);
+      std::copy(res.begin(), res.end(), out.begin() + i * k);
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(count - 1);
+  for (size_t t = 1; t < count; ++t) {
+    workers.emplace_back(run, t);
+  }
+  run(0);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
@@ -30,37 +30,37 @@ struct GenLine {
   Vec<T, D> dir; // L'(t) aka direction and magnitude of line
 
   // constructors
-  GenLine(Vec<T, D> origin, Vec<T, D> dir, LineType type = LineType::LineT) : origin(origin), dir(dir), type(type) {}
+  GenLine(Vec<T, D> origin, Vec<T, D> dir, LineType type = LineType::LineT) : type(type), origin(origin), dir(dir) {}
   GenLine() {}
   template<class... Args>
+  requires (sizeof...(Args) == D * 2 && (std::is_arithmetic_v<Args> && ...))
   GenLine(Args... comps) {
-    static_assert(sizeof...(comps) == D * 2);
     auto args = std::initializer_list<std::common_type_t<Args...>>{comps...};
     for (size_t i = 0; i < D; ++i) {
-      origin[i] = args[i];
-      dir[i] = args[i + D];
+      origin[i] = args.begin()[i];
+      dir[i] = args.begin()[i + D];
     }
   };
 
   // gets point on line L(t) = origin + dir * t
-  constexpr operator()(T t) const {
+  constexpr Vec<T, D> operator()(T t) const {
     return origin + dir * t;
   }
 
   // constructs line from 2 pts on line (a is origin, b - a is dir)
   constexpr static GenLine<T, D, L> from_pts(Vec<T, D> a, Vec<T, D> b) {
-    return { a, b - a };
+    return { a, Vec<T, D>(b - a) };
   }
 
   // point distance to line
   constexpr T dist(const Vec<T, D> &p);
   constexpr T dist(Vec<T, D> &&p) { dist(p); }
 
-  // line intersection
+  // line intersection (2D, uses the exact predicates in predicates.h)
   template<LineType L2>
-  constexpr LineIntersectRes<T, D> intersection(const GenLine<T, D, L2> &) const;
+  LineIntersectRes<T, D> intersection(const GenLine<T, D, L2> &) const;
   template<LineType L2>
-  constexpr LineIntersectRes<T, D> intersection(GenLine<T, D, L2> &&other) const {
+  LineIntersectRes<T, D> intersection(GenLine<T, D, L2> &&other) const {
     return intersection(other);
   }
 
@@ -138,3 +138,6 @@ using Seg2d = Seg2<double>;
 using Seg3i = Seg3<int>;
 using Seg3f = Seg3<float>;
 using Seg3d = Seg3<double>;
+
+// GenLine::intersection
+#include "intersection.h"
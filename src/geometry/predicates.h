@@ -0,0 +1,276 @@
+#pragma once
+
+#include "vec.h"
+#include <stddef.h>
+#include <cstdint>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// Exact geometric predicates (signs of orientation and in-circle determinants)
+// floating point inputs are evaluated in double with Shewchuk's error bounds,
+// only results too close to 0 to trust are recomputed exactly with floating point expansions,
+// integer inputs up to 32 bits use 128-bit integer arithmetic where it fits
+// exact for float, double and integers up to 2^53 (do not compile with -ffast-math)
+
+namespace predicates_detail {
+  constexpr double epsilon = std::numeric_limits<double>::epsilon() / 2;
+  constexpr double ccw_bound = (3 + 16 * epsilon) * epsilon;
+  constexpr double o3d_bound = (7 + 56 * epsilon) * epsilon;
+  constexpr double icc_bound = (10 + 96 * epsilon) * epsilon;
+
+  // integer types whose orientation determinants fit in wide integers
+#ifdef __SIZEOF_INT128__
+  template<class T>
+  constexpr bool small_int = std::is_integral_v<T> && sizeof(T) <= 4;
+  using Wide = __int128;
+#else
+  template<class T>
+  constexpr bool small_int = std::is_integral_v<T> && sizeof(T) <= 2;
+  using Wide = int64_t;
+#endif
+
+  template<class T>
+  int sign(T x) { return (x > 0) - (x < 0); }
+
+  // error-free transformations, a + b = x + y and a * b = x + y exactly
+  inline void fast_two_sum(double a, double b, double &x, double &y) {
+    x = a + b;
+    y = b - (x - a);
+  }
+  inline void two_sum(double a, double b, double &x, double &y) {
+    x = a + b;
+    double b_virt = x - a;
+    double a_virt = x - b_virt;
+    y = (a - a_virt) + (b - b_virt);
+  }
+  inline void two_product(double a, double b, double &x, double &y) {
+    x = a * b;
+    y = std::fma(a, b, -x);
+  }
+
+  // sum of non-overlapping components in increasing magnitude (Shewchuk's expansions)
+  // N is the capacity, zero components are dropped so the last one carries the sign
+  template<size_t N>
+  struct Expansion {
+    std::array<double, N> c;
+    size_t n = 0;
+
+    Expansion() {}
+    Expansion(double x) { push(x); }
+
+    int sign() const { return n == 0 ? 0 : predicates_detail::sign(c[n - 1]); }
+
+    void push(double x) {
+      if (x != 0) {
+        c[n++] = x;
+      }
+    }
+  };
+
+  // a - b exactly
+  inline Expansion<2> diff(double a, double b) {
+    Expansion<2> res;
+    double x = a - b;
+    double b_virt = a - x;
+    double a_virt = x + b_virt;
+    res.push((a - a_virt) + (b_virt - b));
+    res.push(x);
+    return res;
+  }
+
+  template<size_t N>
+  Expansion<N> operator-(Expansion<N> e) {
+    for (size_t i = 0; i < e.n; ++i) {
+      e.c[i] = -e.c[i];
+    }
+    return e;
+  }
+
+  // fast expansion sum with zero elimination
+  template<size_t N, size_t M>
+  Expansion<N + M> operator+(const Expansion<N> &e, const Expansion<M> &f) {
+    Expansion<N + M> res;
+    if (e.n == 0 || f.n == 0) {
+      const double *src = e.n == 0 ? f.c.data() : e.c.data();
+      res.n = e.n + f.n;
+      std::copy(src, src + res.n, res.c.begin());
+      return res;
+    }
+    size_t i = 0, j = 0;
+    // merges by magnitude, each step adds the next smallest component to the running sum q
+    auto next = [&]() {
+      bool take_e = j == f.n || (i < e.n && std::abs(e.c[i]) < std::abs(f.c[j]));
+      return take_e ? e.c[i++] : f.c[j++];
+    };
+    double q = next(), h;
+    if (i + j < e.n + f.n) {
+      fast_two_sum(next(), q, q, h);
+      res.push(h);
+    }
+    while (i + j < e.n + f.n) {
+      two_sum(q, next(), q, h);
+      res.push(h);
+    }
+    if (q != 0 || res.n == 0) {
+      res.c[res.n++] = q;
+    }
+    return res;
+  }
+
+  template<size_t N, size_t M>
+  Expansion<N + M> operator-(const Expansion<N> &e, const Expansion<M> &f) {
+    return e + -f;
+  }
+
+  // e * b with zero elimination
+  template<size_t N>
+  Expansion<2 * N> scale(const Expansion<N> &e, double b) {
+    Expansion<2 * N> res;
+    if (e.n == 0) {
+      return res;
+    }
+    double q, h;
+    two_product(e.c[0], b, q, h);
+    res.push(h);
+    for (size_t i = 1; i < e.n; ++i) {
+      double p1, p0, sum;
+      two_product(e.c[i], b, p1, p0);
+      two_sum(q, p0, sum, h);
+      res.push(h);
+      fast_two_sum(p1, sum, q, h);
+      res.push(h);
+    }
+    if (q != 0 || res.n == 0) {
+      res.c[res.n++] = q;
+    }
+    return res;
+  }
+
+  template<size_t N, size_t M>
+  Expansion<2 * N * M> operator*(const Expansion<N> &e, const Expansion<M> &f) {
+    Expansion<2 * N * M> res;
+    for (size_t i = 0; i < f.n; ++i) {
+      Expansion<2 * N> part = scale(e, f.c[i]);
+      auto sum = res + part;
+      res.n = sum.n;
+      std::copy(sum.c.begin(), sum.c.begin() + sum.n, res.c.begin());
+    }
+    return res;
+  }
+
+  inline int orient2d_exact(double ax, double ay, double bx, double by, double cx, double cy) {
+    return (diff(ax, cx) * diff(by, cy) - diff(ay, cy) * diff(bx, cx)).sign();
+  }
+
+  // Shewchuk's orientation (> 0 if d is below the plane through a, b, c)
+  inline int orient3d_exact(const double *a, const double *b, const double *c, const double *d) {
+    Expansion<2> adx = diff(a[0], d[0]), ady = diff(a[1], d[1]), adz = diff(a[2], d[2]);
+    Expansion<2> bdx = diff(b[0], d[0]), bdy = diff(b[1], d[1]), bdz = diff(b[2], d[2]);
+    Expansion<2> cdx = diff(c[0], d[0]), cdy = diff(c[1], d[1]), cdz = diff(c[2], d[2]);
+    return (adz * (bdx * cdy - cdx * bdy) + bdz * (cdx * ady - adx * cdy) + cdz * (adx * bdy - bdx * ady)).sign();
+  }
+
+  inline int incircle_exact(const double *a, const double *b, const double *c, const double *d) {
+    Expansion<2> adx = diff(a[0], d[0]), ady = diff(a[1], d[1]);
+    Expansion<2> bdx = diff(b[0], d[0]), bdy = diff(b[1], d[1]);
+    Expansion<2> cdx = diff(c[0], d[0]), cdy = diff(c[1], d[1]);
+    auto alift = adx * adx + ady * ady;
+    auto blift = bdx * bdx + bdy * bdy;
+    auto clift = cdx * cdx + cdy * cdy;
+    return (alift * (bdx * cdy - cdx * bdy) + blift * (cdx * ady - adx * cdy) + clift * (adx * bdy - bdx * ady)).sign();
+  }
+}
+
+// > 0 if a -> b -> c turns counterclockwise, < 0 if clockwise, 0 if the points are collinear
+template<class T>
+int orient2d(const Vec2<T> &a, const Vec2<T> &b, const Vec2<T> &c) {
+  using namespace predicates_detail;
+  if constexpr (small_int<T>) {
+    return sign((Wide(b[0]) - a[0]) * (Wide(c[1]) - a[1]) - (Wide(b[1]) - a[1]) * (Wide(c[0]) - a[0]));
+  } else {
+    double acx = double(a[0]) - double(c[0]), bcx = double(b[0]) - double(c[0]);
+    double acy = double(a[1]) - double(c[1]), bcy = double(b[1]) - double(c[1]);
+    double left = acx * bcy, right = acy * bcx;
+    double det = left - right;
+    if (std::abs(det) >= ccw_bound * (std::abs(left) + std::abs(right))) {
+      return sign(det);
+    }
+    return orient2d_exact(a[0], a[1], b[0], b[1], c[0], c[1]);
+  }
+}
+
+// orientation of q relative to the line through p with direction dir (same sign as orient2d(p, p + dir, q))
+template<class T>
+int orient2d_dir(const Vec2<T> &p, const Vec2<T> &dir, const Vec2<T> &q) {
+  using namespace predicates_detail;
+  if constexpr (small_int<T>) {
+    return sign(Wide(dir[0]) * (Wide(q[1]) - p[1]) - Wide(dir[1]) * (Wide(q[0]) - p[0]));
+  } else {
+    double left = double(dir[0]) * (double(q[1]) - double(p[1]));
+    double right = double(dir[1]) * (double(q[0]) - double(p[0]));
+    double det = left - right;
+    if (std::abs(det) >= ccw_bound * (std::abs(left) + std::abs(right))) {
+      return sign(det);
+    }
+    return (Expansion<1>(dir[0]) * diff(q[1], p[1]) - Expansion<1>(dir[1]) * diff(q[0], p[0])).sign();
+  }
+}
+
+// > 0 if d lies on the side of the plane through a, b, c that (b - a) x (c - a) points to,
+// < 0 on the other side, 0 if the points are coplanar
+template<class T>
+int orient3d(const Vec3<T> &a, const Vec3<T> &b, const Vec3<T> &c, const Vec3<T> &d) {
+  using namespace predicates_detail;
+  if constexpr (small_int<T> && sizeof(Wide) > 8) {
+    using W = Wide;
+    W bx = W(b[0]) - a[0], by = W(b[1]) - a[1], bz = W(b[2]) - a[2];
+    W cx = W(c[0]) - a[0], cy = W(c[1]) - a[1], cz = W(c[2]) - a[2];
+    W dx = W(d[0]) - a[0], dy = W(d[1]) - a[1], dz = W(d[2]) - a[2];
+    return sign(dx * (by * cz - bz * cy) + dy * (bz * cx - bx * cz) + dz * (bx * cy - by * cx));
+  }
+  double pa[3], pb[3], pc[3], pd[3];
+  for (size_t i = 0; i < 3; ++i) {
+    pa[i] = a[i];
+    pb[i] = b[i];
+    pc[i] = c[i];
+    pd[i] = d[i];
+  }
+  double adx = pa[0] - pd[0], bdx = pb[0] - pd[0], cdx = pc[0] - pd[0];
+  double ady = pa[1] - pd[1], bdy = pb[1] - pd[1], cdy = pc[1] - pd[1];
+  double adz = pa[2] - pd[2], bdz = pb[2] - pd[2], cdz = pc[2] - pd[2];
+  double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  double cdxady = cdx * ady, adxcdy = adx * cdy;
+  double adxbdy = adx * bdy, bdxady = bdx * ady;
+  double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+  double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+    + (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+    + (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+  // the determinant above is Shewchuk's orientation, which has the opposite sign
+  if (std::abs(det) >= o3d_bound * permanent) {
+    return -sign(det);
+  }
+  return -orient3d_exact(pa, pb, pc, pd);
+}
+
+// > 0 if d lies inside the circle through a, b, c (in CCW order), < 0 outside, 0 on it
+template<class T>
+int incircle(const Vec2<T> &a, const Vec2<T> &b, const Vec2<T> &c, const Vec2<T> &d) {
+  using namespace predicates_detail;
+  double pa[2] = { double(a[0]), double(a[1]) }, pb[2] = { double(b[0]), double(b[1]) };
+  double pc[2] = { double(c[0]), double(c[1]) }, pd[2] = { double(d[0]), double(d[1]) };
+  double adx = pa[0] - pd[0], bdx = pb[0] - pd[0], cdx = pc[0] - pd[0];
+  double ady = pa[1] - pd[1], bdy = pb[1] - pd[1], cdy = pc[1] - pd[1];
+  double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy, alift = adx * adx + ady * ady;
+  double cdxady = cdx * ady, adxcdy = adx * cdy, blift = bdx * bdx + bdy * bdy;
+  double adxbdy = adx * bdy, bdxady = bdx * ady, clift = cdx * cdx + cdy * cdy;
+  double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+  double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift
+    + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+    + (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+  if (std::abs(det) >= icc_bound * permanent) {
+    return sign(det);
+  }
+  return incircle_exact(pa, pb, pc, pd);
+}
@@ -0,0 +1,683 @@
+#pragma once
+
+#include "vec.h"
+#include "predicates.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace quickhull_detail {
+  // signed integer of L 32-bit limbs (two's complement, little endian), arithmetic wraps modulo 2^(32 * L)
+  // like the built-in types, so results are exact as long as they fit
+  template<size_t L>
+  struct FixedInt {
+    uint32_t w[L];
+
+    FixedInt() {}
+    template<class I, class = std::enable_if_t<std::is_integral_v<I>>>
+    FixedInt(I x) {
+      uint64_t low = uint64_t(x);
+      uint32_t fill = std::is_signed_v<I> && x < 0 ? ~uint32_t(0) : 0;
+      for (size_t i = 0; i < L; ++i) {
+        w[i] = i < 2 ? uint32_t(low >> (32 * i)) : fill;
+      }
+    }
+
+    friend FixedInt operator+(const FixedInt &a, const FixedInt &b) {
+      FixedInt res;
+      uint64_t carry = 0;
+      for (size_t i = 0; i < L; ++i) {
+        carry += uint64_t(a.w[i]) + b.w[i];
+        res.w[i] = uint32_t(carry);
+        carry >>= 32;
+      }
+      return res;
+    }
+    friend FixedInt operator-(const FixedInt &a, const FixedInt &b) {
+      FixedInt neg;
+      for (size_t i = 0; i < L; ++i) {
+        neg.w[i] = ~b.w[i];
+      }
+      return a + neg + FixedInt(1);
+    }
+    friend FixedInt operator*(const FixedInt &a, const FixedInt &b) {
+      FixedInt res(0);
+      for (size_t i = 0; i < L; ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; i + j < L; ++j) {
+          carry += uint64_t(a.w[i]) * b.w[j] + res.w[i + j];
+          res.w[i + j] = uint32_t(carry);
+          carry >>= 32;
+        }
+      }
+      return res;
+    }
+  };
+
+  template<class W>
+  int sign(const W &x) { return (x > 0) - (x < 0); }
+
+  template<size_t L>
+  int sign(const FixedInt<L> &x) {
+    if (x.w[L - 1] >> 31) {
+      return -1;
+    }
+    for (size_t i = 0; i < L; ++i) {
+      if (x.w[i]) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+}
+
+// Convex hull of a D-dimensional point set as a simplicial polytope
+// facets have D vertices ordered so the orientation determinant is positive outside the hull,
+// neighbors[f][i] is the facet sharing every vertex of facet f except facets[f][i]
+template<class T, dim_t D>
+struct Polytope {
+  std::vector<Vec<T, D>> vertices;
+  std::vector<std::array<uint32_t, D>> facets; // indices into vertices
+  std::vector<std::array<uint32_t, D>> neighbors; // indices into facets
+
+  void clear() {
+    vertices.clear();
+    facets.clear();
+    neighbors.clear();
+  }
+};
+
+// predicate policies for Quickhull
+// EpsilonPredicate: points closer than eps * (bounding box diagonal) to a facet count as on it
+//   (keeps nearly coplanar points from producing sliver facets)
+// ExactPredicate: exact orientation determinants, orient3d from predicates.h for D = 3 (except 64-bit integers),
+//   otherwise integer T only, expanded by minors in an integer type sized from T and D (no range limit)
+struct EpsilonPredicate {
+  double eps = 1e-10;
+};
+struct ExactPredicate {};
+
+template<class T>
+using DefaultHullPredicate = std::conditional_t<std::is_integral_v<T>, ExactPredicate, EpsilonPredicate>;
+
+// Quickhull for D >= 3
+// each facet keeps a conflict list of the points above it (linked through one array, no allocations),
+// the farthest point of a facet is added and the facets it sees are replaced by a cone to their horizon
+// facets live in a pool and dead slots are reused, all buffers are kept between calls
+
+// T: numerical type (int, float, etc.)
+// D: number of dimensions (D >= 3)
+// P: predicate policy (EpsilonPredicate or ExactPredicate)
+template<class T, dim_t D, class P = DefaultHullPredicate<T>>
+class Quickhull {
+  static_assert(D >= 3);
+  static_assert(std::is_same_v<P, EpsilonPredicate> || std::is_integral_v<T> || D == 3, "ExactPredicate requires integer coordinates for D > 3");
+public:
+  Quickhull(P pred = P()) : pred(pred) {}
+
+  // hull of pts written to res, its vertices are exactly the extreme points (coplanar faces are triangulated)
+  // degenerate input (all points in a hyperplane) gives a polytope without facets
+  void calc(const std::vector<Vec<T, D>> &pts, Polytope<T, D> &res) {
+    calc(pts.data(), pts.size(), res);
+  }
+  void calc(const Vec<T, D> *pts, size_t n, Polytope<T, D> &res) {
+    res.clear();
+    if (!build(pts, n)) {
+      return;
+    }
+    extract(res);
+  }
+
+  // splits the points across threads, hulls each chunk independently,
+  // then hulls the union of the chunk hull vertices (threads = 0 for hardware concurrency)
+  void calc_parallel(const std::vector<Vec<T, D>> &pts, Polytope<T, D> &res, size_t threads = 0) {
+    if (threads == 0) {
+      threads = std::thread::hardware_concurrency();
+    }
+    threads = std::min<size_t>(threads, pts.size() / min_chunk_size);
+    if (threads <= 1) {
+      calc(pts, res);
+      return;
+    }
+    size_t chunk_size = (pts.size() + threads - 1) / threads;
+    std::vector<Polytope<T, D>> parts(threads);
+    auto hull_chunk = [&](size_t i) {
+      size_t first = std::min(pts.size(), i * chunk_size);
+      size_t last = std::min(pts.size(), first + chunk_size);
+      Quickhull<T, D, P>(pred).calc(pts.data() + first, last - first, parts[i]);
+      if (parts[i].facets.empty()) {
+        // degenerate chunk, keep all of its points
+        parts[i].vertices.assign(pts.begin() + first, pts.begin() + last);
+      }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+      workers.emplace_back(hull_chunk, i);
+    }
+    hull_chunk(0);
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+
+    std::vector<Vec<T, D>> candidates;
+    for (Polytope<T, D> &part : parts) {
+      candidates.insert(candidates.end(), part.vertices.begin(), part.vertices.end());
+    }
+    calc(candidates, res);
+  }
+private:
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t min_chunk_size = 1 << 15;
+
+  // bits of the orientation determinant: D coordinate differences of 8 * sizeof(T) + 1 bits each,
+  // summed over D! permutations (log2(D!) <= D * ceil(log2(D))), plus a sign bit
+  static constexpr size_t det_bits() {
+    size_t log_d = 0;
+    while ((size_t(1) << log_d) < D) {
+      ++log_d;
+    }
+    return D * (8 * sizeof(T) + 1 + log_d) + 1;
+  }
+
+  // integer type the exact determinant cannot overflow in
+#ifdef __SIZEOF_INT128__
+  using Wide = std::conditional_t<(det_bits() <= 64), int64_t,
+    std::conditional_t<(det_bits() <= 128), __int128, quickhull_detail::FixedInt<det_bits() / 32 + 1>>>;
+#else
+  using Wide = std::conditional_t<(det_bits() <= 64), int64_t, quickhull_detail::FixedInt<det_bits() / 32 + 1>>;
+#endif
+
+  struct Facet {
+    std::array<uint32_t, D> v; // point indices
+    std::array<uint32_t, D> nb; // nb[i] is across the ridge opposite v[i]
+    double normal[D]; // outward, not normalized
+    double normal_len;
+    uint32_t outside = none; // head of conflict list
+    uint32_t farthest = none;
+    double farthest_dist = 0;
+    uint32_t visit = 0; // iteration in which the facet was found visible
+    bool alive = true;
+  };
+
+  // new facet ridge waiting to be matched with the other new facet sharing it
+  struct RidgeKey {
+    std::array<uint32_t, D - 2> key;
+    uint32_t facet;
+    uint32_t index; // position in facet of the vertex not in the ridge (other than the apex)
+  };
+
+  P pred;
+  const Vec<T, D> *pts = nullptr;
+  double tol = 0; // distance tolerance (EpsilonPredicate)
+
+  std::vector<Facet> facets;
+  std::vector<uint32_t> free_facets;
+  std::vector<uint32_t> next_point; // conflict lists (next point in the same list)
+  std::vector<uint32_t> stack;
+  std::vector<uint32_t> visible;
+  std::vector<std::pair<uint32_t, uint32_t>> horizon; // (visible facet, index of the ridge's opposite vertex)
+  std::vector<uint32_t> new_facets;
+  std::vector<RidgeKey> ridges;
+  std::vector<uint32_t> vertex_ids;
+  mutable std::vector<Wide> minors; // exact_det_sign
+  uint32_t iteration = 0;
+
+  bool build(const Vec<T, D> *in, size_t n) {
+    pts = in;
+    facets.clear();
+    free_facets.clear();
+    stack.clear();
+    iteration = 0;
+    if (n < D + 1) {
+      return false;
+    }
+    next_point.assign(n, none);
+
+    std::array<uint32_t, D + 1> simplex;
+    if (!initial_simplex(n, simplex)) {
+      return false;
+    }
+    create_simplex(simplex);
+
+    // assign every point to the first facet it is above
+    for (uint32_t p = 0; p < n; ++p) {
+      for (uint32_t f = 0; f <= D; ++f) {
+        if (add_conflict(f, p)) {
+          break;
+        }
+      }
+    }
+    for (uint32_t f = 0; f <= D; ++f) {
+      if (facets[f].outside != none) {
+        stack.push_back(f);
+      }
+    }
+
+    while (!stack.empty()) {
+      uint32_t f = stack.back();
+      stack.pop_back();
+      if (facets[f].alive && facets[f].outside != none) {
+        add_point(f);
+      }
+    }
+    return true;
+  }
+
+  // picks D + 1 affinely independent points, each as far as possible from the span of the previous
+  bool initial_simplex(size_t n, std::array<uint32_t, D + 1> &simplex) {
+    uint32_t lo = 0, hi = 0;
+    Vec<T, D> bb_min = pts[0], bb_max = pts[0];
+    for (uint32_t i = 1; i < n; ++i) {
+      if (pts[i][0] < pts[lo][0]) {
+        lo = i;
+      }
+      if (pts[i][0] > pts[hi][0]) {
+        hi = i;
+      }
+      for (size_t d = 0; d < D; ++d) {
+        bb_min[d] = std::min(bb_min[d], pts[i][d]);
+        bb_max[d] = std::max(bb_max[d], pts[i][d]);
+      }
+    }
+    double extent = 0;
+    for (size_t d = 0; d < D; ++d) {
+      double len = double(bb_max[d]) - double(bb_min[d]);
+      extent += len * len;
+    }
+    extent = std::sqrt(extent);
+    if constexpr (std::is_same_v<P, EpsilonPredicate>) {
+      tol = pred.eps * extent;
+    }
+    if (extent == 0) {
+      return false;
+    }
+    simplex[0] = lo;
+    if (pts[hi][0] == pts[lo][0]) {
+      // all points share x, the farthest from simplex[0] still spans a line (the extent is not 0)
+      hi = farthest_from_span(n, simplex.data(), 0, nullptr);
+    }
+    simplex[1] = hi;
+
+    // orthonormal basis of the span of the simplex so far (relative to simplex[0])
+    double basis[D][D];
+    size_t dims = 0;
+    for (size_t k = 1; k <= D; ++k) {
+      if (k > 1) {
+        simplex[k] = farthest_from_span(n, simplex.data(), dims, basis);
+      }
+      double dir[D];
+      offset(pts[simplex[k]], pts[simplex[0]], dir);
+      double len = reject(dir, basis, dims);
+      if (len <= tol || len == 0) {
+        return false;
+      }
+      for (size_t d = 0; d < D; ++d) {
+        basis[dims][d] = dir[d] / len;
+      }
+      ++dims;
+    }
+    return orient_sign(simplex.data(), pts[simplex[D]]) != 0;
+  }
+
+  // point farthest from the affine span of simplex[0] and the first dims basis vectors
+  uint32_t farthest_from_span(size_t n, const uint32_t *simplex, size_t dims, const double (*basis)[D]) const {
+    uint32_t best = simplex[0];
+    double best_len = -1;
+    for (uint32_t i = 0; i < n; ++i) {
+      double dir[D];
+      offset(pts[i], pts[simplex[0]], dir);
+      double len = reject(dir, basis, dims);
+      if (len > best_len) {
+        best_len = len;
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  static void offset(const Vec<T, D> &a, const Vec<T, D> &b, double (&res)[D]) {
+    for (size_t d = 0; d < D; ++d) {
+      res[d] = double(a[d]) - double(b[d]);
+    }
+  }
+
+  // removes the components of dir along the basis, returns the remaining length
+  static double reject(double (&dir)[D], const double (*basis)[D], size_t dims) {
+    for (size_t b = 0; b < dims; ++b) {
+      double dot = 0;
+      for (size_t d = 0; d < D; ++d) {
+        dot += dir[d] * basis[b][d];
+      }
+      for (size_t d = 0; d < D; ++d) {
+        dir[d] -= dot * basis[b][d];
+      }
+    }
+    double len = 0;
+    for (size_t d = 0; d < D; ++d) {
+      len += dir[d] * dir[d];
+    }
+    return std::sqrt(len);
+  }
+
+  void create_simplex(std::array<uint32_t, D + 1> &simplex) {
+    // make the simplex positively oriented so facet i can keep vertex order (with a sign fix)
+    if (orient_sign(simplex.data(), pts[simplex[D]]) < 0) {
+      std::swap(simplex[0], simplex[1]);
+    }
+    for (size_t i = 0; i <= D; ++i) {
+      uint32_t f = alloc_facet();
+      Facet &facet = facets[f];
+      size_t k = 0;
+      for (size_t j = 0; j <= D; ++j) {
+        if (j != i) {
+          facet.v[k] = simplex[j];
+          facet.nb[k] = j;
+          ++k;
+        }
+      }
+      // orientation of facet i relative to simplex[i] is (-1)^(D - i) times that of the simplex
+      if ((D - i) % 2 == 0) {
+        std::swap(facet.v[0], facet.v[1]);
+        std::swap(facet.nb[0], facet.nb[1]);
+      }
+      compute_plane(f);
+    }
+  }
+
+  uint32_t alloc_facet() {
+    uint32_t f;
+    if (!free_facets.empty()) {
+      f = free_facets.back();
+      free_facets.pop_back();
+      facets[f] = Facet();
+    } else {
+      f = facets.size();
+      facets.emplace_back();
+    }
+    return f;
+  }
+
+  // outward normal (cofactors of the orientation determinant) used for distances
+  void compute_plane(uint32_t f) {
+    Facet &facet = facets[f];
+    double rows[D][D];
+    for (size_t k = 1; k < D; ++k) {
+      offset(pts[facet.v[k]], pts[facet.v[0]], rows[k - 1]);
+    }
+    if constexpr (D == 3) {
+      facet.normal[0] = rows[0][1] * rows[1][2] - rows[0][2] * rows[1][1];
+      facet.normal[1] = rows[0][2] * rows[1][0] - rows[0][0] * rows[1][2];
+      facet.normal[2] = rows[0][0] * rows[1][1] - rows[0][1] * rows[1][0];
+    } else {
+      for (size_t c = 0; c < D; ++c) {
+        for (size_t d = 0; d < D; ++d) {
+          rows[D - 1][d] = d == c;
+        }
+        facet.normal[c] = det(rows);
+      }
+    }
+    double len = 0;
+    for (size_t d = 0; d < D; ++d) {
+      len += facet.normal[d] * facet.normal[d];
+    }
+    facet.normal_len = std::sqrt(len);
+  }
+
+  // determinant by Gaussian elimination with partial pivoting
+  static double det(const double (&m)[D][D]) {
+    double a[D][D];
+    std::copy(&m[0][0], &m[0][0] + D * D, &a[0][0]);
+    double res = 1;
+    for (size_t c = 0; c < D; ++c) {
+      size_t pivot = c;
+      for (size_t r = c + 1; r < D; ++r) {
+        if (std::abs(a[r][c]) > std::abs(a[pivot][c])) {
+          pivot = r;
+        }
+      }
+      if (a[pivot][c] == 0) {
+        return 0;
+      }
+      if (pivot != c) {
+        std::swap(a[pivot], a[c]);
+        res = -res;
+      }
+      res *= a[c][c];
+      for (size_t r = c + 1; r < D; ++r) {
+        double factor = a[r][c] / a[c][c];
+        for (size_t k = c; k < D; ++k) {
+          a[r][k] -= factor * a[c][k];
+        }
+      }
+    }
+    return res;
+  }
+
+  double dist(const Facet &facet, const Vec<T, D> &p) const {
+    double res = 0;
+    for (size_t d = 0; d < D; ++d) {
+      res += facet.normal[d] * (double(p[d]) - double(pts[facet.v[0]][d]));
+    }
+    return res;
+  }
+
+  // sign of the orientation determinant of the D points v and p
+  int orient_sign(const uint32_t *v, const Vec<T, D> &p) const {
+    if constexpr (std::is_same_v<P, ExactPredicate> && D == 3 && !(std::is_integral_v<T> && sizeof(T) > 4)) {
+      return orient3d(pts[v[0]], pts[v[1]], pts[v[2]], p);
+    } else if constexpr (std::is_same_v<P, ExactPredicate>) {
+      Wide m[D][D];
+      for (size_t k = 1; k <= D; ++k) {
+        const Vec<T, D> &row = k < D ? pts[v[k]] : p;
+        for (size_t d = 0; d < D; ++d) {
+          m[k - 1][d] = Wide(row[d]) - Wide(pts[v[0]][d]);
+        }
+      }
+      return exact_det_sign(m);
+    } else {
+      double rows[D][D];
+      for (size_t k = 1; k < D; ++k) {
+        offset(pts[v[k]], pts[v[0]], rows[k - 1]);
+      }
+      offset(p, pts[v[0]], rows[D - 1]);
+      double res = det(rows);
+      return (res > 0) - (res < 0);
+    }
+  }
+
+  // expansion by minors over the rows, minors[S] is the minor of the first |S| rows and the columns in S
+  // (D * 2^D products, no divisions, every minor fits in Wide since it is bounded by the full determinant's bound)
+  int exact_det_sign(const Wide (&m)[D][D]) const {
+    minors.resize(size_t(1) << D);
+    minors[0] = Wide(1);
+    for (size_t set = 1; set < minors.size(); ++set) {
+      size_t row = 0;
+      for (size_t rest = set; rest &= rest - 1;) {
+        ++row;
+      }
+      // expand along the last row, the sign alternates from the highest column down
+      Wide res = Wide(0);
+      bool negate = false;
+      for (size_t c = D; c-- > 0;) {
+        if (!(set >> c & 1)) {
+          continue;
+        }
+        Wide term = m[row][c] * minors[set & ~(size_t(1) << c)];
+        res = negate ? res - term : res + term;
+        negate = !negate;
+      }
+      minors[set] = res;
+    }
+    return quickhull_detail::sign(minors.back());
+  }
+
+  // true if p is strictly above facet f (outside the hull)
+  bool above(uint32_t f, const Vec<T, D> &p, double &d) const {
+    const Facet &facet = facets[f];
+    d = dist(facet, p);
+    if constexpr (std::is_same_v<P, ExactPredicate>) {
+      return orient_sign(facet.v.data(), p) > 0;
+    } else {
+      return d > tol * facet.normal_len;
+    }
+  }
+
+  // adds p to the conflict list of f if it is above f
+  bool add_conflict(uint32_t f, uint32_t p) {
+    double d;
+    if (!above(f, pts[p], d)) {
+      return false;
+    }
+    Facet &facet = facets[f];
+    next_point[p] = facet.outside;
+    facet.outside = p;
+    if (facet.farthest == none || d > facet.farthest_dist) {
+      facet.farthest = p;
+      facet.farthest_dist = d;
+    }
+    return true;
+  }
+
+  // true if apex sees facet f or lies in its plane (used to grow the visible region)
+  // replacing coplanar facets too keeps vertices that end up inside a face or on an edge out of the hull,
+  // only facets apex is strictly below survive, so every hull vertex is an extreme point
+  bool sees(uint32_t f, uint32_t apex) const {
+    if constexpr (std::is_same_v<P, ExactPredicate>) {
+      return orient_sign(facets[f].v.data(), pts[apex]) >= 0;
+    } else {
+      return dist(facets[f], pts[apex]) > -tol * facets[f].normal_len;
+    }
+  }
+
+  // adds the farthest point of f, replacing the facets it sees with a cone to their horizon
+  void add_point(uint32_t start) {
+    uint32_t apex = facets[start].farthest;
+    ++iteration;
+
+    // flood fill the visible region, recording its boundary ridges
+    visible.clear();
+    horizon.clear();
+    visible.push_back(start);
+    facets[start].visit = iteration;
+    for (size_t i = 0; i < visible.size(); ++i) {
+      uint32_t f = visible[i];
+      for (size_t k = 0; k < D; ++k) {
+        uint32_t nb = facets[f].nb[k];
+        if (facets[nb].visit == iteration) {
+          continue;
+        }
+        if (sees(nb, apex)) {
+          facets[nb].visit = iteration;
+          visible.push_back(nb);
+        } else {
+          horizon.emplace_back(f, k);
+        }
+      }
+    }
+
+    // one new facet per horizon ridge: the visible facet with its opposite vertex replaced by apex
+    // (keeps the orientation, since apex is above the visible facet)
+    new_facets.clear();
+    ridges.clear();
+    for (auto [f, k] : horizon) {
+      uint32_t g = alloc_facet();
+      Facet &facet = facets[g];
+      facet.v = facets[f].v;
+      facet.v[k] = apex;
+      facet.visit = iteration;
+      uint32_t nb = facets[f].nb[k];
+      facet.nb[k] = nb;
+      for (size_t j = 0; j < D; ++j) {
+        if (facets[nb].nb[j] == f) {
+          facets[nb].nb[j] = g;
+        }
+      }
+      compute_plane(g);
+      new_facets.push_back(g);
+
+      // the other ridges of g contain apex and are shared with another new facet
+      for (size_t j = 0; j < D; ++j) {
+        if (j == k) {
+          continue;
+        }
+        RidgeKey ridge;
+        size_t pos = 0;
+        for (size_t i = 0; i < D; ++i) {
+          if (i != j && i != k) {
+            ridge.key[pos++] = facet.v[i];
+          }
+        }
+        std::sort(ridge.key.begin(), ridge.key.end());
+        ridge.facet = g;
+        ridge.index = j;
+        ridges.push_back(ridge);
+      }
+    }
+    std::sort(ridges.begin(), ridges.end(), [](const RidgeKey &a, const RidgeKey &b) { return a.key < b.key; });
+    for (size_t i = 0; i + 1 < ridges.size(); i += 2) {
+      facets[ridges[i].facet].nb[ridges[i].index] = ridges[i + 1].facet;
+      facets[ridges[i + 1].facet].nb[ridges[i + 1].index] = ridges[i].facet;
+    }
+
+    // redistribute the conflict points of the visible facets (points above none are inside)
+    for (uint32_t f : visible) {
+      uint32_t p = facets[f].outside;
+      while (p != none) {
+        uint32_t next = next_point[p];
+        if (p != apex) {
+          for (uint32_t g : new_facets) {
+            if (add_conflict(g, p)) {
+              break;
+            }
+          }
+        }
+        p = next;
+      }
+      facets[f].alive = false;
+      facets[f].outside = none;
+      free_facets.push_back(f);
+    }
+    for (uint32_t g : new_facets) {
+      if (facets[g].outside != none) {
+        stack.push_back(g);
+      }
+    }
+  }
+
+  // copies live facets into res, renumbering vertices and facets
+  void extract(Polytope<T, D> &res) {
+    vertex_ids.assign(next_point.size(), none);
+    std::vector<uint32_t> &facet_ids = new_facets;
+    facet_ids.assign(facets.size(), none);
+    for (uint32_t f = 0; f < facets.size(); ++f) {
+      if (facets[f].alive) {
+        facet_ids[f] = res.facets.size();
+        res.facets.emplace_back();
+      }
+    }
+    res.neighbors.resize(res.facets.size());
+    for (uint32_t f = 0; f < facets.size(); ++f) {
+      if (!facets[f].alive) {
+        continue;
+      }
+      uint32_t id = facet_ids[f];
+      for (size_t k = 0; k < D; ++k) {
+        uint32_t p = facets[f].v[k];
+        if (vertex_ids[p] == none) {
+          vertex_ids[p] = res.vertices.size();
+          res.vertices.push_back(pts[p]);
+        }
+        res.facets[id][k] = vertex_ids[p];
+        res.neighbors[id][k] = facet_ids[facets[f].nb[k]];
+      }
+    }
+  }
+};
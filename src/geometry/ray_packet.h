@@ -0,0 +1,153 @@
+#pragma once
+
+#include "shape.h"
+#include "../util/simd.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+// Bundle of N lines, rays or segments tested against one shape at a time
+// lanes are stored as structure of arrays (with inverse directions precomputed),
+// so each test runs SimdReg<T>::width lanes per instruction (util/simd.h)
+// results are a mask with bit i set if lane i hits, and optionally the entry parameter t of every lane
+// (origin + dir * t, clamped to the start of the lane's range, only meaningful where the bit is set)
+// shapes are closed, touching counts as a hit
+
+// T: floating point type
+// N: lanes (1 to 32, the widest register whose width divides N is used)
+// D: number of dimensions (D >= 1)
+template<class T, size_t N, dim_t D = 3>
+class RayPacket {
+  static_assert(std::is_floating_point_v<T>);
+  static_assert(N >= 1 && N <= 32);
+  static_assert(D >= 1);
+
+  // packets narrower than the widest register use a narrower one (or one lane at a time)
+  using R = DividingReg<T, N>;
+  using reg = typename R::reg;
+public:
+  // all lanes empty (never hit)
+  RayPacket() {
+    for (size_t i = 0; i < N; ++i) {
+      clear(i);
+    }
+  }
+
+  // fills the first count lanes (count <= N), the rest are empty
+  template<LineType L>
+  RayPacket(const GenLine<T, D, L> *lines, size_t count) : RayPacket() {
+    for (size_t i = 0; i < count; ++i) {
+      set(i, lines[i]);
+    }
+  }
+
+  template<LineType L>
+  void set(size_t lane, const GenLine<T, D, L> &line) {
+    T len_sqd = 0;
+    for (size_t i = 0; i < D; ++i) {
+      origin[i][lane] = line.origin[i];
+      dir[i][lane] = line.dir[i];
+      // + 0 turns -0 into +0, so parallel axes always get +inf (see intersects)
+      inv_dir[i][lane] = T(1) / (line.dir[i] + T(0));
+      len_sqd += line.dir[i] * line.dir[i];
+    }
+    dir_sqd[lane] = len_sqd;
+    shape_detail::line_range<L>(t_min[lane], t_max[lane]);
+    // finite, so a lane outside a slab it runs parallel to (entering at +-inf) still misses
+    t_min[lane] = std::max(t_min[lane], std::numeric_limits<T>::lowest());
+    t_max[lane] = std::min(t_max[lane], std::numeric_limits<T>::max());
+  }
+
+  void clear(size_t lane) {
+    for (size_t i = 0; i < D; ++i) {
+      origin[i][lane] = dir[i][lane] = inv_dir[i][lane] = 0;
+    }
+    dir_sqd[lane] = 0;
+    t_min[lane] = std::numeric_limits<T>::infinity();
+    t_max[lane] = -std::numeric_limits<T>::infinity();
+  }
+
+  // slab test
+  uint32_t intersects(const Rect<T, D> &rect, T *t = nullptr) const;
+
+  // sphere test
+  uint32_t intersects(const Circ<T, D> &circ, T *t = nullptr) const;
+private:
+  alignas(64) T origin[D][N];
+  alignas(64) T dir[D][N];
+  alignas(64) T inv_dir[D][N];
+  alignas(64) T dir_sqd[N];
+  alignas(64) T t_min[N];
+  alignas(64) T t_max[N];
+};
+
+// a lane parallel to an axis and on one of its slab planes gets 0 * inf = NaN there,
+// min and max return their second operand on NaN, so the operand order below makes that axis not clip the lane
+template<class T, size_t N, dim_t D>
+uint32_t RayPacket<T, N, D>::intersects(const Rect<T, D> &rect, T *t) const {
+  reg lo[D], hi[D];
+  for (size_t i = 0; i < D; ++i) {
+    lo[i] = R::set1(rect.pos[i]);
+    hi[i] = R::set1(rect.pos[i] + rect.size[i]);
+  }
+  uint32_t res = 0;
+  for (size_t k = 0; k < N; k += R::width) {
+    reg t0 = R::load(t_min + k), t1 = R::load(t_max + k);
+    for (size_t i = 0; i < D; ++i) {
+      reg o = R::load(origin[i] + k), inv = R::load(inv_dir[i] + k);
+      reg a = R::mul(R::sub(lo[i], o), inv), b = R::mul(R::sub(hi[i], o), inv);
+      t0 = R::max(R::min(b, a), t0);
+      t1 = R::min(R::max(a, b), t1);
+    }
+    res |= (~R::bits(R::less(t1, t0)) & ((1u << R::width) - 1)) << k;
+    if (t) {
+      R::store(t + k, t0);
+    }
+  }
+  return res;
+}
+
+// solves |origin + dir * t - pos|^2 = radius^2 in every lane
+template<class T, size_t N, dim_t D>
+uint32_t RayPacket<T, N, D>::intersects(const Circ<T, D> &circ, T *t) const {
+  reg pos[D];
+  for (size_t i = 0; i < D; ++i) {
+    pos[i] = R::set1(circ.pos[i]);
+  }
+  reg r_sqd = R::set1(circ.radius * circ.radius), zero = R::set1(0);
+  uint32_t res = 0;
+  for (size_t k = 0; k < N; k += R::width) {
+    reg b = zero, c = zero;
+    for (size_t i = 0; i < D; ++i) {
+      reg oc = R::sub(R::load(origin[i] + k), pos[i]);
+      b = R::add(b, R::mul(R::load(dir[i] + k), oc));
+      c = R::add(c, R::mul(oc, oc));
+    }
+    c = R::sub(c, r_sqd);
+    reg a = R::load(dir_sqd + k);
+    reg disc = R::sub(R::mul(b, b), R::mul(a, c));
+    reg root = R::sqrt(R::max(disc, zero));
+    // a zero direction gives NaN roots, which leave [t_min, t_max] as is (it then hits if the origin is inside)
+    reg t0 = R::max(R::div(R::sub(R::sub(zero, b), root), a), R::load(t_min + k));
+    reg t1 = R::min(R::div(R::sub(root, b), a), R::load(t_max + k));
+    uint32_t miss = R::bits(R::less(disc, zero)) | R::bits(R::less(t1, t0));
+    uint32_t outside = R::bits(R::less(zero, c)) & ~R::bits(R::less(zero, a));
+    res |= (~(miss | outside) & ((1u << R::width) - 1)) << k;
+    if (t) {
+      R::store(t + k, t0);
+    }
+  }
+  return res;
+}
+
+// shorthands
+template<size_t N>
+using RayPacket2f = RayPacket<float, N, 2>;
+template<size_t N>
+using RayPacket3f = RayPacket<float, N, 3>;
+template<size_t N>
+using RayPacket2d = RayPacket<double, N, 2>;
+template<size_t N>
+using RayPacket3d = RayPacket<double, N, 3>;
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "shape.h"
+#include "predicates.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Union of a set of 2D rects (closed boxes, rects with no area are ignored)
+// area and perimeter come from a sweep along x over a segment tree of the compressed y coordinates,
+// O(n log n), the multithreaded mode splits the sweep into vertical strips, each started from the rects crossing it
+// point queries use a segment tree over the compressed x coordinates whose nodes hold the merged y intervals
+// of the rects spanning them, O(log^2 n)
+// queries are const and can run concurrently
+
+// T: numerical type (int, float, etc.)
+template<class T>
+class RectUnion {
+public:
+  // exact for integers up to 32 bits
+  using Area = std::conditional_t<predicates_detail::small_int<T>, predicates_detail::Wide, double>;
+
+  struct Measure {
+    Area area, perimeter;
+  };
+
+  // stores the rects and builds the point index, O(n log n)
+  void build(const Rect2<T> *rects, size_t n);
+  void build(const std::vector<Rect2<T>> &rects) {
+    build(rects.data(), rects.size());
+  }
+
+  // area and perimeter of the union, the sweep is split across threads (0 for hardware concurrency)
+  Measure measure(size_t threads = 0) const { return sweep(rects, threads); }
+  Area area(size_t threads = 0) const { return measure(threads).area; }
+  Area perimeter(size_t threads = 0) const { return measure(threads).perimeter; }
+
+  // whether p is inside (or on the boundary of) any rect
+  bool covered(const Vec2<T> &p) const;
+
+  // fraction of window covered by the union, O(n log n)
+  double coverage(const Rect2<T> &window, size_t threads = 0) const;
+private:
+  // sweeps with fewer rects per thread are not split
+  static constexpr size_t min_parallel_size = 1 << 12;
+
+  std::vector<Rect2<T>> rects; // ones with area
+
+  // point index: slot 2i is the coordinate xs[i], slot 2i + 1 the open range between xs[i] and xs[i + 1]
+  // node k holds intervals[starts[k], starts[k + 1]) (sorted, disjoint), leaves are at slots + leaf_base
+  std::vector<T> xs;
+  size_t leaf_base = 0;
+  std::vector<uint32_t> starts;
+  std::vector<std::pair<T, T>> intervals;
+
+  static T lo(const Rect2<T> &r, size_t axis) { return r.pos[axis]; }
+  static T hi(const Rect2<T> &r, size_t axis) { return r.pos[axis] + r.size[axis]; }
+
+  // covered length and number of covered runs over compressed y coordinates
+  class CoverTree {
+    const std::vector<T> &ys;
+    std::vector<int32_t> count; // rects covering a node entirely
+    std::vector<Area> len;
+    std::vector<uint32_t> runs;
+    std::vector<uint8_t> ends; // bit 0: bottom covered, bit 1: top covered
+  public:
+    CoverTree(const std::vector<T> &ys) : ys(ys) {
+      size_t size = 4 * std::max<size_t>(ys.size(), 1);
+      count.assign(size, 0);
+      len.assign(size, 0);
+      runs.assign(size, 0);
+      ends.assign(size, 0);
+    }
+
+    // adds delta to the elementary intervals [first, last)
+    void add(uint32_t first, uint32_t last, int32_t delta) {
+      add(1, 0, uint32_t(ys.size() - 1), first, last, delta);
+    }
+    Area length() const { return len[1]; }
+    uint32_t run_count() const { return runs[1]; }
+  private:
+    void add(size_t node, uint32_t l, uint32_t r, uint32_t first, uint32_t last, int32_t delta) {
+      if (last <= l || r <= first) {
+        return;
+      }
+      if (first <= l && r <= last) {
+        count[node] += delta;
+      } else {
+        uint32_t mid = (l + r) / 2;
+        add(2 * node, l, mid, first, last, delta);
+        add(2 * node + 1, mid, r, first, last, delta);
+      }
+      if (count[node] > 0) {
+        len[node] = Area(ys[r]) - Area(ys[l]);
+        runs[node] = 1;
+        ends[node] = 3;
+      } else if (r - l == 1) {
+        len[node] = 0;
+        runs[node] = 0;
+        ends[node] = 0;
+      } else {
+        size_t a = 2 * node, b = 2 * node + 1;
+        len[node] = len[a] + len[b];
+        // runs meeting at the middle join
+        runs[node] = runs[a] + runs[b] - ((ends[a] & 2) && (ends[b] & 1));
+        ends[node] = (ends[a] & 1) | (ends[b] & 2);
+      }
+    }
+  };
+
+  static size_t thread_count(size_t threads, size_t work) {
+    size_t res = threads != 0 ? threads : std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(res, work / min_parallel_size));
+  }
+
+  static Measure sweep(const std::vector<Rect2<T>> &rects, size_t threads);
+};
+
+template<class T>
+typename RectUnion<T>::Measure RectUnion<T>::sweep(const std::vector<Rect2<T>> &rects, size_t threads) {
+  Measure res = { 0, 0 };
+  if (rects.empty()) {
+    return res;
+  }
+  std::vector<T> ys;
+  ys.reserve(2 * rects.size());
+  for (const Rect2<T> &r : rects) {
+    ys.push_back(lo(r, 1));
+    ys.push_back(hi(r, 1));
+  }
+  std::sort(ys.begin(), ys.end());
+  ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+  auto y_index = [&](T y) { return uint32_t(std::lower_bound(ys.begin(), ys.end(), y) - ys.begin()); };
+
+  // rect edges along x, at equal x starts come first so touching rects do not count a shared edge
+  struct Event {
+    T x;
+    int32_t delta;
+    uint32_t first, last;
+  };
+  std::vector<Event> events;
+  events.reserve(2 * rects.size());
+  for (const Rect2<T> &r : rects) {
+    uint32_t first = y_index(lo(r, 1)), last = y_index(hi(r, 1));
+    events.push_back({ lo(r, 0), 1, first, last });
+    events.push_back({ hi(r, 0), -1, first, last });
+  }
+  std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+    return a.x < b.x || (a.x == b.x && a.delta > b.delta);
+  });
+
+  // strip t covers events [bounds[t], bounds[t + 1]), bounds start new x coordinates
+  size_t strips = thread_count(threads, rects.size());
+  std::vector<size_t> bounds = { 0 };
+  for (size_t t = 1; t < strips; ++t) {
+    size_t i = std::max(bounds.back() + 1, events.size() * t / strips);
+    while (i < events.size() && events[i].x == events[i - 1].x) {
+      ++i;
+    }
+    if (i < events.size()) {
+      bounds.push_back(i);
+    }
+  }
+  bounds.push_back(events.size());
+  strips = bounds.size() - 1;
+
+  std::vector<Measure> parts(strips, Measure{ 0, 0 });
+  auto run = [&](size_t t) {
+    CoverTree tree(ys);
+    T start = events[bounds[t]].x;
+    // rects crossing the strip's start (their end may be an event of this strip)
+    if (t > 0) {
+      for (const Rect2<T> &r : rects) {
+        if (lo(r, 0) < start && hi(r, 0) >= start) {
+          tree.add(y_index(lo(r, 1)), y_index(hi(r, 1)), 1);
+        }
+      }
+    }
+    Area area = 0, perimeter = 0;
+    T prev = start;
+    auto advance = [&](T x) {
+      Area dx = Area(x) - Area(prev);
+      area += tree.length() * dx;
+      perimeter += 2 * Area(tree.run_count()) * dx;
+      prev = x;
+    };
+    for (size_t i = bounds[t]; i < bounds[t + 1]; ++i) {
+      const Event &e = events[i];
+      advance(e.x);
+      Area before = tree.length();
+      tree.add(e.first, e.last, e.delta);
+      Area change = tree.length() - before;
+      perimeter += change < 0 ? -change : change;
+    }
+    if (t + 1 < strips) {
+      advance(events[bounds[t + 1]].x);
+    }
+    parts[t] = { area, perimeter };
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(strips - 1);
+  for (size_t t = 1; t < strips; ++t) {
+    workers.emplace_back(run, t);
+  }
+  run(0);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  for (const Measure &part : parts) {
+    res.area += part.area;
+    res.perimeter += part.perimeter;
+  }
+  return res;
+}
+
+template<class T>
+void RectUnion<T>::build(const Rect2<T> *first, size_t n) {
+  rects.clear();
+  for (size_t i = 0; i < n; ++i) {
+    if (first[i].size[0] > 0 && first[i].size[1] > 0) {
+      rects.push_back(first[i]);
+    }
+  }
+
+  xs.clear();
+  for (const Rect2<T> &r : rects) {
+    xs.push_back(lo(r, 0));
+    xs.push_back(hi(r, 0));
+  }
+  std::sort(xs.begin(), xs.end());
+  xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+  size_t slots = xs.empty() ? 1 : 2 * xs.size() - 1;
+  leaf_base = 1;
+  while (leaf_base < slots) {
+    leaf_base *= 2;
+  }
+
+  // canonical nodes of each rect's slot range (bottom-up segment tree), then grouped by node
+  std::vector<std::pair<uint32_t, std::pair<T, T>>> parts;
+  for (const Rect2<T> &r : rects) {
+    size_t l = 2 * (std::lower_bound(xs.begin(), xs.end(), lo(r, 0)) - xs.begin()) + leaf_base;
+    size_t h = 2 * (std::lower_bound(xs.begin(), xs.end(), hi(r, 0)) - xs.begin()) + leaf_base + 1;
+    for (; l < h; l /= 2, h /= 2) {
+      if (l & 1) {
+        parts.push_back({ uint32_t(l++), { lo(r, 1), hi(r, 1) } });
+      }
+      if (h & 1) {
+        parts.push_back({ uint32_t(--h), { lo(r, 1), hi(r, 1) } });
+      }
+    }
+  }
+  std::sort(parts.begin(), parts.end());
+  starts.assign(2 * leaf_base + 1, 0);
+  intervals.clear();
+  for (size_t i = 0; i < parts.size(); ++i) {
+    uint32_t node = parts[i].first;
+    const std::pair<T, T> &y = parts[i].second;
+    // merge overlapping intervals of the same node
+    if (i > 0 && parts[i - 1].first == node && y.first <= intervals.back().second) {
+      intervals.back().second = std::max(intervals.back().second, y.second);
+    } else {
+      intervals.push_back(y);
+      ++starts[node + 1];
+    }
+  }
+  for (size_t k = 0; k + 1 < starts.size(); ++k) {
+    starts[k + 1] += starts[k];
+  }
+}
+
+template<class T>
+bool RectUnion<T>::covered(const Vec2<T> &p) const {
+  if (xs.empty() || p[0] < xs.front() || p[0] > xs.back()) {
+    return false;
+  }
+  size_t i = std::lower_bound(xs.begin(), xs.end(), p[0]) - xs.begin();
+  size_t slot = xs[i] == p[0] ? 2 * i : 2 * i - 1;
+  for (size_t node = slot + leaf_base; node >= 1; node /= 2) {
+    auto first = intervals.begin() + starts[node], last = intervals.begin() + starts[node + 1];
+    // last interval starting at or below p.y
+    auto it = std::upper_bound(first, last, p[1], [](T y, const std::pair<T, T> &in) { return y < in.first; });
+    if (it != first && std::prev(it)->second >= p[1]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<class T>
+double RectUnion<T>::coverage(const Rect2<T> &window, size_t threads) const {
+  if (!(window.size[0] > 0 && window.size[1] > 0)) {
+    return 0;
+  }
+  std::vector<Rect2<T>> clipped;
+  for (const Rect2<T> &r : rects) {
+    Vec2<T> a, b;
+    for (size_t i = 0; i < 2; ++i) {
+      a[i] = std::max(lo(r, i), lo(window, i));
+      b[i] = std::min(hi(r, i), hi(window, i));
+    }
+    if (a[0] < b[0] && a[1] < b[1]) {
+      clipped.push_back({ a, Vec2<T>(b - a) });
+    }
+  }
+  return double(sweep(clipped, threads).area) / (double(window.size[0]) * double(window.size[1]));
+}
@@ -0,0 +1,378 @@
+#pragma once
+
+#include "line.h"
+#include "predicates.h"
+#include "../ordered_containers/skiplist.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// intersection between segments a and b (indices into the input, a < b)
+template<class T>
+struct SegIntersectRes {
+  uint32_t a, b;
+  LineIntersectRes<T, 2> res;
+};
+
+// Bentley-Ottmann sweep over a set of 2D segments, O((n + k) log n) for k intersecting pairs
+// the sweep status is a SkipList ordered by where segments cross the sweep line,
+// crossings found between neighbors are queued as events and visited in (x, y) order
+// every decision uses exact predicates: crossings are kept as the pair of segments that meet there,
+// compared through a floating point filter and exact expansions when the filter is unsure
+// reported pairs are resolved with GenLine::intersection
+// (exact for float, double and integers up to 2^53, reported crossing points are rounded to T)
+// buffers are kept between calls (not thread-safe, keep one per thread)
+template<class T>
+class SegmentSweep {
+public:
+  // all intersecting pairs, each reported once
+  // pairs meeting in one point give OnePoint, collinear overlaps give Infinite
+  void find_all(const Seg2<T> *segs, size_t n, std::vector<SegIntersectRes<T>> &out) {
+    out.clear();
+    sweep<false>(segs, n, &out);
+  }
+  void find_all(const std::vector<Seg2<T>> &segs, std::vector<SegIntersectRes<T>> &out) {
+    find_all(segs.data(), segs.size(), out);
+  }
+
+  // true if any two segments intersect (Shamos-Hoey: no crossing events, stops at the first one found)
+  // the pair found is written to pair if given
+  bool any(const Seg2<T> *segs, size_t n, std::pair<uint32_t, uint32_t> *pair = nullptr) {
+    found = { none, none };
+    bool res = sweep<true>(segs, n, nullptr);
+    if (res && pair) {
+      *pair = found;
+    }
+    return res;
+  }
+  bool any(const std::vector<Seg2<T>> &segs, std::pair<uint32_t, uint32_t> *pair = nullptr) {
+    return any(segs.data(), segs.size(), pair);
+  }
+private:
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  // endpoints in lexicographic order (a before b)
+  struct Segment {
+    Vec2<double> a, b;
+  };
+
+  // event point, an endpoint (v == none, exact) or the crossing of segments u and v
+  // x and y are within err of the exact point
+  struct Event {
+    double x, y, err;
+    uint32_t u, v;
+  };
+
+  struct Endpoint {
+    Vec2<double> p;
+    uint32_t seg;
+    bool start;
+  };
+
+  // exact homogeneous coordinates (x / w, y / w) with w > 0
+  struct Hom {
+    predicates_detail::Expansion<96> x, y;
+    predicates_detail::Expansion<16> w;
+  };
+
+  // status entry, compared by where the segment crosses the sweep line at the current event
+  // segments through the event are ordered by direction (as just after it), then by index
+  struct Entry {
+    uint32_t seg = none;
+    const SegmentSweep *sweep = nullptr;
+
+    bool operator<(const Entry &other) const { return sweep->less(seg, other.seg); }
+    bool operator==(const Entry &other) const { return seg == other.seg; }
+    bool operator!=(const Entry &other) const { return seg != other.seg; }
+  };
+
+  const Seg2<T> *input = nullptr;
+  std::vector<Segment> segments;
+  std::vector<Endpoint> endpoints;
+  std::vector<Event> events; // min-heap of crossings
+  std::vector<uint32_t> through, starts;
+  SkipList<Entry, 20> status;
+  Event curr;
+  uint32_t probe = none; // value searched for in the status (none: below every segment through curr)
+  std::pair<uint32_t, uint32_t> found;
+
+  template<bool Any>
+  bool sweep(const Seg2<T> *segs, size_t n, std::vector<SegIntersectRes<T>> *out) {
+    input = segs;
+    segments.resize(n);
+    endpoints.clear();
+    for (size_t i = 0; i < n; ++i) {
+      Vec2<T> a = segs[i].a(), b = segs[i].b();
+      Vec2<double> pa(a[0], a[1]), pb(b[0], b[1]);
+      if (lex_less(pb, pa)) {
+        std::swap(pa, pb);
+      }
+      segments[i] = { pa, pb };
+      endpoints.push_back({ pa, uint32_t(i), true });
+      endpoints.push_back({ pb, uint32_t(i), false });
+    }
+    std::sort(endpoints.begin(), endpoints.end(), [](const Endpoint &l, const Endpoint &r) { return lex_less(l.p, r.p); });
+    events.clear();
+    status.clear();
+
+    size_t i = 0;
+    while (i < endpoints.size() || !events.empty()) {
+      if (i < endpoints.size() && (events.empty() || compare(endpoint_event(i), events.front()) <= 0)) {
+        curr = endpoint_event(i);
+      } else {
+        curr = events.front();
+      }
+      while (!events.empty() && compare(events.front(), curr) == 0) {
+        std::pop_heap(events.begin(), events.end(), later());
+        events.pop_back();
+      }
+      starts.clear();
+      for (; i < endpoints.size() && endpoints[i].p[0] == curr.x && endpoints[i].p[1] == curr.y; ++i) {
+        if (endpoints[i].start) {
+          starts.push_back(endpoints[i].seg);
+        }
+      }
+
+      // segments through the event are contiguous in the status
+      probe = none;
+      size_t low = status.rank(Entry{ none, this });
+      through.clear();
+      for (auto it = status.lower_bound(Entry{ none, this }); it != status.end() && side(it->seg, curr) == 0; ++it) {
+        through.push_back(it->seg);
+        if (Any && through.size() == 2) {
+          break;
+        }
+      }
+      if (through.size() + starts.size() >= 2) {
+        if constexpr (Any) {
+          through.insert(through.end(), starts.begin(), starts.end());
+          found = { std::min(through[0], through[1]), std::max(through[0], through[1]) };
+          return true;
+        } else {
+          report(*out);
+        }
+      }
+
+      for (size_t k = 0; k < through.size(); ++k) {
+        status.erase_at(low);
+      }
+      size_t inserted = 0;
+      for (uint32_t s : through) {
+        inserted += reinsert(s);
+      }
+      for (uint32_t s : starts) {
+        inserted += reinsert(s);
+      }
+
+      // new neighbors
+      bool hit = false;
+      if (inserted == 0) {
+        if (low > 0 && low < status.size()) {
+          hit = check<Any>(status.at(low - 1).seg, status.at(low).seg);
+        }
+      } else {
+        if (low > 0) {
+          hit = check<Any>(status.at(low - 1).seg, status.at(low).seg);
+        }
+        if (!hit && low + inserted < status.size()) {
+          hit = check<Any>(status.at(low + inserted - 1).seg, status.at(low + inserted).seg);
+        }
+      }
+      if constexpr (Any) {
+        if (hit) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // inserts s into the status if it continues past the current event
+  size_t reinsert(uint32_t s) {
+    const Segment &seg = segments[s];
+    if (curr.v == none && seg.b[0] == curr.x && seg.b[1] == curr.y) {
+      return 0;
+    }
+    probe = s;
+    status.insert(Entry{ s, this });
+    return 1;
+  }
+
+  // neighbors s (below) and t (above) in the status
+  // Any: true if they intersect at all
+  // otherwise a proper crossing still ahead of the sweep (s turns up into t) is queued,
+  // touching at an endpoint is left to that endpoint's event and overlaps to the later start
+  template<bool Any>
+  bool check(uint32_t s, uint32_t t) {
+    const Segment &p = segments[s], &q = segments[t];
+    int o1 = orient2d(p.a, p.b, q.a), o2 = orient2d(p.a, p.b, q.b);
+    int o3 = orient2d(q.a, q.b, p.a), o4 = orient2d(q.a, q.b, p.b);
+    if constexpr (Any) {
+      bool hit;
+      if (o1 == 0 && o2 == 0) {
+        // collinear, overlapping if their lexicographic ranges do
+        hit = !lex_less(p.b, q.a) && !lex_less(q.b, p.a);
+      } else {
+        hit = o1 * o2 <= 0 && o3 * o4 <= 0;
+      }
+      if (hit) {
+        found = { std::min(s, t), std::max(s, t) };
+      }
+      return hit;
+    } else {
+      if (o1 * o2 < 0 && o3 * o4 < 0 && dir_cross(s, t) < 0) {
+        events.push_back(crossing(s, t));
+        std::push_heap(events.begin(), events.end(), later());
+      }
+      return false;
+    }
+  }
+
+  // reports every pair through the current event
+  void report(std::vector<SegIntersectRes<T>> &out) {
+    through.insert(through.end(), starts.begin(), starts.end());
+    for (size_t i = 0; i < through.size(); ++i) {
+      for (size_t j = i + 1; j < through.size(); ++j) {
+        uint32_t s = std::min(through[i], through[j]), t = std::max(through[i], through[j]);
+        // collinear overlaps are reported once, where the later segment starts
+        if (dir_cross(s, t) == 0 && (curr.v != none || (!at_curr(segments[s].a) && !at_curr(segments[t].a)))) {
+          continue;
+        }
+        out.push_back({ s, t, input[s].intersection(input[t]) });
+      }
+    }
+    through.resize(through.size() - starts.size());
+  }
+
+  // heap order of events (earliest on top)
+  auto later() const {
+    return [this](const Event &l, const Event &r) { return compare(l, r) > 0; };
+  }
+
+  bool less(uint32_t a, uint32_t b) const {
+    if (a == b) {
+      return false;
+    }
+    if (b == probe) {
+      int sa = side(a, curr);
+      return sa > 0 || (sa == 0 && b != none && (dir_cross(a, b) > 0 || (dir_cross(a, b) == 0 && a < b)));
+    }
+    if (a == probe) {
+      int sb = side(b, curr);
+      return sb < 0 || (sb == 0 && (a == none || dir_cross(a, b) > 0 || (dir_cross(a, b) == 0 && a < b)));
+    }
+    return a < b;
+  }
+
+  static bool lex_less(const Vec2<double> &a, const Vec2<double> &b) {
+    return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+  }
+
+  bool at_curr(const Vec2<double> &p) const {
+    return p[0] == curr.x && p[1] == curr.y;
+  }
+
+  Event endpoint_event(size_t i) const {
+    return { endpoints[i].p[0], endpoints[i].p[1], 0, endpoints[i].seg, none };
+  }
+
+  // crossing of two segments that cross properly (den is not 0)
+  Event crossing(uint32_t s, uint32_t t) const {
+    using namespace predicates_detail;
+    const Segment &u = segments[s], &v = segments[t];
+    double dux = u.b[0] - u.a[0], duy = u.b[1] - u.a[1];
+    double dvx = v.b[0] - v.a[0], dvy = v.b[1] - v.a[1];
+    double wx = v.a[0] - u.a[0], wy = v.a[1] - u.a[1];
+    double den_l = dux * dvy, den_r = duy * dvx, den = den_l - den_r;
+    double num_l = wx * dvy, num_r = wy * dvx, num = num_l - num_r;
+    double err_den = ccw_bound * (std::abs(den_l) + std::abs(den_r));
+    double err_num = ccw_bound * (std::abs(num_l) + std::abs(num_r));
+    Event res{ 0, 0, std::numeric_limits<double>::infinity(), s, t };
+    if (den == 0) {
+      return res;
+    }
+    // u.a + (u.b - u.a) * num / den, with the error of num / den and of each rounding on the way
+    double frac = num / den;
+    res.x = u.a[0] + frac * dux;
+    res.y = u.a[1] + frac * duy;
+    if (std::abs(den) > 2 * err_den) {
+      double err_frac = (err_num + std::abs(frac) * err_den) / (std::abs(den) - err_den) + epsilon * std::abs(frac);
+      double d = std::max(std::abs(dux), std::abs(duy));
+      res.err = 2 * ((1 + epsilon) * d * err_frac + 2 * epsilon * std::abs(frac) * d + epsilon * std::max(std::abs(res.x), std::abs(res.y)));
+    }
+    return res;
+  }
+
+  Hom exact(const Event &e) const {
+    using namespace predicates_detail;
+    if (e.v == none) {
+      return { Expansion<96>(e.x), Expansion<96>(e.y), Expansion<16>(1.0) };
+    }
+    const Segment &u = segments[e.u], &v = segments[e.v];
+    Expansion<2> dux = diff(u.b[0], u.a[0]), duy = diff(u.b[1], u.a[1]);
+    Expansion<2> dvx = diff(v.b[0], v.a[0]), dvy = diff(v.b[1], v.a[1]);
+    Expansion<16> den = dux * dvy - duy * dvx;
+    Expansion<16> num = diff(v.a[0], u.a[0]) * dvy - diff(v.a[1], u.a[1]) * dvx;
+    Hom res{ Expansion<1>(u.a[0]) * den + num * dux, Expansion<1>(u.a[1]) * den + num * duy, den };
+    if (den.sign() < 0) {
+      res.x = -res.x;
+      res.y = -res.y;
+      res.w = -res.w;
+    }
+    return res;
+  }
+
+  // lexicographic comparison of event points
+  int compare(const Event &a, const Event &b) const {
+    int res = compare_coord(a, b, 0);
+    return res != 0 ? res : compare_coord(a, b, 1);
+  }
+
+  int compare_coord(const Event &a, const Event &b, size_t i) const {
+    double d = i == 0 ? a.x - b.x : a.y - b.y;
+    if (std::abs(d) > a.err + b.err || (a.err == 0 && b.err == 0)) {
+      return predicates_detail::sign(d);
+    }
+    Hom ha = exact(a), hb = exact(b);
+    return i == 0 ? (ha.x * hb.w - hb.x * ha.w).sign() : (ha.y * hb.w - hb.y * ha.w).sign();
+  }
+
+  // > 0 if p is above segment s, < 0 below, 0 on its line
+  int side(uint32_t s, const Event &p) const {
+    using namespace predicates_detail;
+    const Segment &seg = segments[s];
+    if (p.v == none) {
+      return orient2d(seg.a, seg.b, Vec2<double>(p.x, p.y));
+    }
+    if (s == p.u || s == p.v) {
+      return 0;
+    }
+    double sdx = seg.b[0] - seg.a[0], sdy = seg.b[1] - seg.a[1];
+    double left = sdx * (p.y - seg.a[1]), right = sdy * (p.x - seg.a[0]);
+    double det = left - right;
+    if (std::abs(det) > ccw_bound * (std::abs(left) + std::abs(right)) + 2 * (std::abs(sdx) + std::abs(sdy)) * p.err) {
+      return sign(det);
+    }
+    Hom h = exact(p);
+    auto y = h.y - Expansion<1>(seg.a[1]) * h.w;
+    auto x = h.x - Expansion<1>(seg.a[0]) * h.w;
+    return (diff(seg.b[0], seg.a[0]) * y - diff(seg.b[1], seg.a[1]) * x).sign();
+  }
+
+  // sign of (s.b - s.a) x (t.b - t.a)
+  int dir_cross(uint32_t s, uint32_t t) const {
+    using namespace predicates_detail;
+    const Segment &p = segments[s], &q = segments[t];
+    double left = (p.b[0] - p.a[0]) * (q.b[1] - q.a[1]), right = (p.b[1] - p.a[1]) * (q.b[0] - q.a[0]);
+    double det = left - right;
+    if (std::abs(det) >= ccw_bound * (std::abs(left) + std::abs(right))) {
+      return sign(det);
+    }
+    return (diff(p.b[0], p.a[0]) * diff(q.b[1], q.a[1]) - diff(p.b[1], p.a[1]) * diff(q.b[0], q.a[0])).sign();
+  }
+};
@@ -4,7 +4,12 @@
 
 #include "line.h"
 #include "convex_hull.h"
+#include "dynamic_hull.h"
+#include <algorithm>
+#include <cmath>
 #include <iterator>
+#include <limits>
+#include <type_traits>
 #include <vector>
 #include <utility>
 
@@ -22,7 +27,7 @@ struct Circ {
 
   // returns distance from point to nearest edge (negative if overlapping)
   constexpr T dist(const Vec<T, D> &p);
-  constexpr T dist(Vec<T, D> &&p) { dist(p); }
+  constexpr T dist(Vec<T, D> &&p) { return dist(p); }
 
   // line intersection
   template<LineType L> constexpr bool intersects(const GenLine<T, D, L> &) const;
@@ -46,26 +51,77 @@ struct Rect {
   Vec<T, D> size;
 
   // convert to poly
-  Poly<T> to_poly() {
+  Poly<T> to_poly() const {
     static_assert(D == 2);
-    // TODO
+    Vec2<T> hi = pos + size;
+    return Poly<T>({ pos, Vec2<T>(hi[0], pos[1]), hi, Vec2<T>(pos[0], hi[1]) });
   }
 
   // shape intersection
+  constexpr bool intersects(const Circ<T, D> &other) const { return other.intersects(*this); }
+  constexpr bool intersects(const Rect<T, D> &) const;
+  constexpr bool intersects(const Poly<T> &) const;
 };
 
 // Represents a convex 2D polygon
+// points are CCW without collinear points, starting at the leftmost point (lowest on ties)
+// the point where the lower chain (x increasing) meets the upper chain is kept,
+// so queries binary search each chain instead of walking the whole poly
 template<class T>
 class Poly {
-  const std::vector<Vec2<T>> pts; // points (CCW)
+  std::vector<Vec2<T>> pts; // points (CCW)
+  size_t right = 0; // rightmost point (highest on ties)
 public:
   // constructs a poly by finding the convex hull of the points
   // pts do not need to be ordered
-  Poly(const std::vector<Vec2<T>> &pts) : pts(ConvexHull<T, 2>::calc(pts)) {}
+  Poly(const std::vector<Vec2<T>> &pts) : pts(ConvexHull<T, 2>::calc(pts)) { find_right(); }
+  // snapshots of online hulls (already convex, no hull computation)
+  Poly(const IncrementalHull<T> &hull) : pts(hull.points()) { find_right(); }
+  Poly(const DynamicHull<T> &hull) : pts(hull.points()) { find_right(); }
 
-  std::vector<Vec2<T>>::iterator begin() { return pts.begin(); }
-  std::vector<Vec2<T>>::iterator end() { return pts.end(); }
+  typename std::vector<Vec2<T>>::const_iterator begin() const { return pts.begin(); }
+  typename std::vector<Vec2<T>>::const_iterator end() const { return pts.end(); }
   size_t size() const { return pts.size(); }
+  const Vec2<T> &operator[](size_t i) const { return pts[i]; }
+
+  // O(log n) queries, decided with the exact predicates in predicates.h
+  // whether p is inside or on the boundary (binary search for the wedge from the first point holding p)
+  bool contains(const Vec2<T> &p) const;
+  // index of a point furthest in direction dir (dir != 0)
+  size_t extreme(const Vec2<T> &dir) const;
+  // indices of the points touched by the two lines parallel to dir, on its left and on its right
+  void tangents(const Vec2<T> &dir, size_t &left, size_t &right) const {
+    left = extreme(Vec2<T>(-dir[1], dir[0]));
+    right = extreme(Vec2<T>(dir[1], -dir[0]));
+  }
+  // whether a line crosses or touches the poly
+  bool stabs(const Line2<T> &line) const;
+
+  // O(n + m) merge of both edge sequences by angle
+  static Poly<T> minkowski_sum(const Poly<T> &a, const Poly<T> &b);
+  // point reflection through the origin
+  Poly<T> operator-() const;
+
+  // shape intersection
+  bool intersects(const Circ<T, 2> &other) const { return other.intersects(*this); }
+  bool intersects(const Rect<T, 2> &other) const { return other.intersects(*this); }
+  // O(n + m), the origin is in the Minkowski difference
+  bool intersects(const Poly<T> &) const;
+private:
+  Poly() {}
+
+  void find_right() {
+    right = 0;
+    for (size_t i = 1; i < pts.size(); ++i) {
+      if (pts[i][0] > pts[right][0] || (pts[i][0] == pts[right][0] && pts[i][1] > pts[right][1])) {
+        right = i;
+      }
+    }
+  }
+
+  // furthest point in direction dir along the chain of edges points start..start + edges (wrapping)
+  // edge directions of a chain span less than half a turn, so their dot product with dir changes sign at most once
+  size_t chain_extreme(size_t start, size_t edges, const Vec2<T> &dir) const;
 };
 
 // shorthands
@@ -90,3 +146,338 @@ using Rect2d = Rect2<double>;
 using Rect3i = Rect3<int>;
 using Rect3f = Rect3<float>;
 using Rect3d = Rect3<double>;
+
+namespace shape_detail {
+  // type shape tests are computed in
+  template<class T>
+  using Real = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+  template<class T, dim_t D>
+  constexpr Vec<Real<T>, D> real(const Vec<T, D> &v) {
+    Vec<Real<T>, D> res;
+    for (size_t i = 0; i < D; ++i) {
+      res[i] = Real<T>(v[i]);
+    }
+    return res;
+  }
+
+  // parameter range of origin + dir * t covered by a line type
+  template<LineType L, class S>
+  constexpr void line_range(S &t0, S &t1) {
+    t0 = L == LineT ? -std::numeric_limits<S>::infinity() : 0;
+    t1 = L == SegT ? 1 : std::numeric_limits<S>::infinity();
+  }
+
+  // clips [t0, t1] of o + d * t to the part inside the shape, false if nothing is left
+  template<class T, dim_t D, class S = Real<T>>
+  bool clip(const Circ<T, D> &c, const Vec<S, D> &o, const Vec<S, D> &d, S &t0, S &t1) {
+    S a = 0, b = 0, cc = 0;
+    for (size_t i = 0; i < D; ++i) {
+      S oc = o[i] - S(c.pos[i]);
+      a += d[i] * d[i];
+      b += d[i] * oc;
+      cc += oc * oc;
+    }
+    cc -= S(c.radius) * S(c.radius);
+    if (a == 0) {
+      return cc <= 0 && t0 <= t1;
+    }
+    S disc = b * b - a * cc;
+    if (disc < 0) {
+      return false;
+    }
+    S sq = std::sqrt(disc);
+    t0 = std::max(t0, (-b - sq) / a);
+    t1 = std::min(t1, (-b + sq) / a);
+    return t0 <= t1;
+  }
+
+  // slab test
+  template<class S, dim_t D>
+  bool clip_box(const S *lo, const S *hi, const Vec<S, D> &o, const Vec<S, D> &d, S &t0, S &t1) {
+    for (size_t i = 0; i < D; ++i) {
+      if (d[i] == 0) {
+        if (o[i] < lo[i] || o[i] > hi[i]) {
+          return false;
+        }
+        continue;
+      }
+      S a = (lo[i] - o[i]) / d[i], b = (hi[i] - o[i]) / d[i];
+      t0 = std::max(t0, std::min(a, b));
+      t1 = std::min(t1, std::max(a, b));
+    }
+    return t0 <= t1;
+  }
+
+  template<class T, dim_t D, class S = Real<T>>
+  bool clip(const Rect<T, D> &r, const Vec<S, D> &o, const Vec<S, D> &d, S &t0, S &t1) {
+    S lo[D], hi[D];
+    for (size_t i = 0; i < D; ++i) {
+      lo[i] = S(r.pos[i]);
+      hi[i] = S(r.pos[i]) + S(r.size[i]);
+    }
+    return clip_box(lo, hi, o, d, t0, t1);
+  }
+
+  // Cyrus-Beck, each CCW edge keeps the part of the line on its left
+  template<class T, class S = Real<T>>
+  bool clip(const Poly<T> &poly, const Vec2<S> &o, const Vec2<S> &d, S &t0, S &t1) {
+    size_t n = poly.size();
+    if (n <= 1) {
+      if (n == 0) {
+        return false;
+      }
+      S p[2] = { S(poly[0][0]), S(poly[0][1]) };
+      return clip_box(p, p, o, d, t0, t1);
+    }
+    for (size_t i = 0; i < n && t0 <= t1; ++i) {
+      Vec2<S> p = real(poly[i]), q = real(poly[i + 1 == n ? 0 : i + 1]);
+      S ex = q[0] - p[0], ey = q[1] - p[1];
+      S num = ex * (o[1] - p[1]) - ey * (o[0] - p[0]);
+      S den = ex * d[1] - ey * d[0];
+      if (den == 0) {
+        if (num < 0) {
+          return false;
+        }
+      } else if (den > 0) {
+        t0 = std::max(t0, -num / den);
+      } else {
+        t1 = std::min(t1, -num / den);
+      }
+    }
+    // both edges of a 2 point poly lie on one line, its endpoints bound it along the edge
+    if (n == 2 && t0 <= t1) {
+      Vec2<S> p = real(poly[0]), q = real(poly[1]);
+      S ex = q[0] - p[0], ey = q[1] - p[1];
+      S den = ex * d[0] + ey * d[1];
+      S lo = ex * (p[0] - o[0]) + ey * (p[1] - o[1]), hi = ex * (q[0] - o[0]) + ey * (q[1] - o[1]);
+      if (den == 0) {
+        return lo <= 0 && 0 <= hi;
+      }
+      S a = lo / den, b = hi / den;
+      t0 = std::max(t0, std::min(a, b));
+      t1 = std::min(t1, std::max(a, b));
+    }
+    return t0 <= t1;
+  }
+
+  // sign of dir . (q - p), exact (-90 degree turn of dir turns orient2d_dir's cross product into a dot product)
+  template<class T>
+  int dot_sign(const Vec2<T> &p, const Vec2<T> &dir, const Vec2<T> &q) {
+    return -orient2d_dir(p, Vec2<T>(-dir[1], dir[0]), q);
+  }
+}
+
+template<class T, dim_t D>
+constexpr bool Circ<T, D>::intersects(const Circ<T, D> &other) const {
+  using S = shape_detail::Real<T>;
+  S dist_sqd = 0, r = S(radius) + S(other.radius);
+  for (size_t i = 0; i < D; ++i) {
+    S d = S(pos[i]) - S(other.pos[i]);
+    dist_sqd += d * d;
+  }
+  return dist_sqd <= r * r;
+}
+
+// distance from the center to the closest point of the box
+template<class T, dim_t D>
+constexpr bool Circ<T, D>::intersects(const Rect<T, D> &rect) const {
+  using S = shape_detail::Real<T>;
+  S dist_sqd = 0;
+  for (size_t i = 0; i < D; ++i) {
+    S lo = S(rect.pos[i]), hi = lo + S(rect.size[i]), c = S(pos[i]);
+    S d = c < lo ? lo - c : (c > hi ? c - hi : 0);
+    dist_sqd += d * d;
+  }
+  return dist_sqd <= S(radius) * S(radius);
+}
+
+// center inside the polygon or within radius of an edge
+template<class T, dim_t D>
+constexpr bool Circ<T, D>::intersects(const Poly<T> &poly) const {
+  static_assert(D == 2);
+  using S = shape_detail::Real<T>;
+  size_t n = poly.size();
+  S cx = S(pos[0]), cy = S(pos[1]), r_sqd = S(radius) * S(radius);
+  bool inside = n >= 3;
+  for (size_t i = 0; i < n; ++i) {
+    Vec2<S> p = shape_detail::real(poly[i]), q = shape_detail::real(poly[i + 1 == n ? 0 : i + 1]);
+    S ex = q[0] - p[0], ey = q[1] - p[1], px = cx - p[0], py = cy - p[1];
+    S len_sqd = ex * ex + ey * ey;
+    S t = len_sqd == 0 ? 0 : std::clamp((px * ex + py * ey) / len_sqd, S(0), S(1));
+    S dx = px - ex * t, dy = py - ey * t;
+    if (dx * dx + dy * dy <= r_sqd) {
+      return true;
+    }
+    inside = inside && ex * py - ey * px >= 0;
+  }
+  return inside;
+}
+
+template<class T, dim_t D>
+constexpr bool Rect<T, D>::intersects(const Rect<T, D> &other) const {
+  using S = shape_detail::Real<T>;
+  for (size_t i = 0; i < D; ++i) {
+    if (S(pos[i]) + S(size[i]) < S(other.pos[i]) || S(other.pos[i]) + S(other.size[i]) < S(pos[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template<class T, dim_t D>
+constexpr bool Rect<T, D>::intersects(const Poly<T> &poly) const {
+  static_assert(D == 2);
+  return to_poly().intersects(poly);
+}
+
+template<class T>
+bool Poly<T>::contains(const Vec2<T> &p) const {
+  size_t n = pts.size();
+  if (n <= 2) {
+    if (n == 0) {
+      return false;
+    }
+    return n == 1 ? p == pts[0] : orient2d(pts[0], pts[1], p) == 0
+      && shape_detail::dot_sign(pts[0], Vec2<T>(pts[1] - pts[0]), p) >= 0
+      && shape_detail::dot_sign(pts[1], Vec2<T>(pts[0] - pts[1]), p) >= 0;
+  }
+  // points are sorted by angle around pts[0]
+  if (orient2d(pts[0], pts[1], p) < 0 || orient2d(pts[0], pts[n - 1], p) > 0) {
+    return false;
+  }
+  // last i in [1, n - 2] with p left of (or on) pts[0] -> pts[i]
+  size_t lo = 1, hi = n - 2;
+  while (lo < hi) {
+    size_t mid = (lo + hi + 1) / 2;
+    if (orient2d(pts[0], pts[mid], p) >= 0) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return orient2d(pts[lo], pts[lo + 1], p) >= 0;
+}
+
+template<class T>
+size_t Poly<T>::chain_extreme(size_t start, size_t edges, const Vec2<T> &dir) const {
+  size_t n = pts.size();
+  auto at = [&](size_t j) -> const Vec2<T> & { return pts[(start + j) % n]; };
+  auto rises = [&](size_t j) { return shape_detail::dot_sign(at(j), dir, at(j + 1)) > 0; };
+  if (edges == 0) {
+    return start % n;
+  }
+  bool first = rises(0);
+  // first edge j where rises(j) != first
+  size_t lo = 1, hi = edges;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (rises(mid) == first) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (first) {
+    // rises up to point lo, then falls
+    return (start + lo) % n;
+  }
+  // falls, then rises, so one of the ends
+  return shape_detail::dot_sign(at(0), dir, at(edges)) > 0 ? (start + edges) % n : start % n;
+}
+
+template<class T>
+size_t Poly<T>::extreme(const Vec2<T> &dir) const {
+  size_t n = pts.size();
+  if (n <= 1) {
+    return 0;
+  }
+  size_t lower = chain_extreme(0, right, dir), upper = chain_extreme(right, n - right, dir);
+  return shape_detail::dot_sign(pts[lower], dir, pts[upper]) > 0 ? upper : lower;
+}
+
+template<class T>
+bool Poly<T>::stabs(const Line2<T> &line) const {
+  if (pts.empty()) {
+    return false;
+  }
+  if (line.dir == Vec2<T>()) {
+    return contains(line.origin);
+  }
+  size_t left, right;
+  tangents(line.dir, left, right);
+  return orient2d_dir(line.origin, line.dir, pts[left]) >= 0 && orient2d_dir(line.origin, line.dir, pts[right]) <= 0;
+}
+
+// edges of both polys are merged by angle starting from their leftmost points,
+// the sum of the leftmost points is the leftmost point of the sum
+template<class T>
+Poly<T> Poly<T>::minkowski_sum(const Poly<T> &a, const Poly<T> &b) {
+  Poly<T> res;
+  size_t n = a.size(), m = b.size();
+  if (n == 0 || m == 0) {
+    return res;
+  }
+  res.pts.reserve(n + m);
+  size_t i = 0, j = 0;
+  while (i < n || j < m) {
+    res.pts.push_back(a.pts[i % n] + b.pts[j % m]);
+    // > 0 takes the edge of a next, < 0 the edge of b, parallel edges are taken together
+    int turn = i == n ? -1 : (j == m ? 1 : orient2d_dir(Vec2<T>(), Vec2<T>(a.pts[(i + 1) % n] - a.pts[i]),
+      Vec2<T>(b.pts[(j + 1) % m] - b.pts[j])));
+    if (turn >= 0) {
+      ++i;
+    }
+    if (turn <= 0) {
+      ++j;
+    }
+  }
+  res.find_right();
+  return res;
+}
+
+template<class T>
+Poly<T> Poly<T>::operator-() const {
+  Poly<T> res;
+  size_t n = pts.size();
+  res.pts.resize(n);
+  // the rightmost point becomes the leftmost one
+  for (size_t k = 0; k < n; ++k) {
+    res.pts[k] = -pts[(right + k) % n];
+  }
+  res.find_right();
+  return res;
+}
+
+template<class T>
+bool Poly<T>::intersects(const Poly<T> &other) const {
+  return minkowski_sum(*this, -other).contains(Vec2<T>());
+}
+
+template<class T, dim_t D, LineType L>
+constexpr bool GenLine<T, D, L>::intersects(const Circ<T, D> &circ) const {
+  using S = shape_detail::Real<T>;
+  S t0, t1;
+  shape_detail::line_range<L>(t0, t1);
+  return shape_detail::clip(circ, shape_detail::real(origin), shape_detail::real(dir), t0, t1);
+}
+
+template<class T, dim_t D, LineType L>
+constexpr bool GenLine<T, D, L>::intersects(const Rect<T, D> &rect) const {
+  using S = shape_detail::Real<T>;
+  S t0, t1;
+  shape_detail::line_range<L>(t0, t1);
+  return shape_detail::clip(rect, shape_detail::real(origin), shape_detail::real(dir), t0, t1);
+}
+
+template<class T, dim_t D, LineType L>
+constexpr bool GenLine<T, D, L>::intersects(const Poly<T> &poly) const {
+  static_assert(D == 2);
+  if constexpr (L == LineT) {
+    return poly.stabs(*this);
+  }
+  using S = shape_detail::Real<T>;
+  S t0, t1;
+  shape_detail::line_range<L>(t0, t1);
+  return shape_detail::clip(poly, shape_detail::real(origin), shape_detail::real(dir), t0, t1);
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "shape.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Uniform grid broadphase for many similarly sized circles (spheres in 3D)
+// each circle is filed under the cell holding its center, cells are at least one diameter wide,
+// so overlapping circles are always in the same or neighboring cells
+// build is a parallel counting sort into one flat array (no per-cell allocation),
+// each cell gets a few spare slots so circles can move between cells without a rebuild
+// pair enumeration splits the cells across threads, candidates are confirmed with Circ::intersects
+// not thread-safe itself (the threads are internal)
+
+// T: numerical type (int, float, etc.)
+// D: number of dimensions (D >= 1)
+template<class T, dim_t D>
+class UniformGrid {
+  static_assert(D >= 1);
+
+  using S = shape_detail::Real<T>;
+public:
+  // cell_size: smallest cell width (0 for the largest diameter), raised to the largest diameter if smaller
+  // threads: 0 for hardware concurrency
+  UniformGrid(T cell_size = 0, size_t threads = 0) : min_cell_size(S(cell_size)), threads(threads) {}
+
+  // files all circles, ids are indices into circs
+  void build(const Circ<T, D> *circs, size_t n) {
+    objects.assign(circs, circs + n);
+    rebuild();
+  }
+  void build(const std::vector<Circ<T, D>> &circs) {
+    build(circs.data(), circs.size());
+  }
+
+  // moves circle id, O(1) if it stays inside the grid, fits the cell size and its new cell has a spare slot
+  // otherwise the grid is rebuilt on the next query (returns false)
+  bool update(uint32_t id, const Circ<T, D> &circ) {
+    objects[id] = circ;
+    if (dirty) {
+      return false;
+    }
+    uint32_t cell;
+    if (S(circ.radius) * 2 > cell_size || !cell_of(circ, cell)) {
+      dirty = true;
+      return false;
+    }
+    uint32_t old = cells[id];
+    if (cell == old) {
+      return true;
+    }
+    if (cell_start[cell] + cell_count[cell] == cell_start[cell + 1]) {
+      dirty = true;
+      return false;
+    }
+    // last circle of the old cell fills the hole
+    uint32_t last = items[cell_start[old] + --cell_count[old]];
+    items[slots[id]] = last;
+    slots[last] = slots[id];
+    slots[id] = cell_start[cell] + cell_count[cell]++;
+    items[slots[id]] = id;
+    cells[id] = cell;
+    return true;
+  }
+
+  // all pairs of overlapping circles (smaller id first), each reported once
+  void pairs(std::vector<std::pair<uint32_t, uint32_t>> &out);
+
+  size_t size() const { return objects.size(); }
+  const Circ<T, D> &operator[](uint32_t id) const { return objects[id]; }
+private:
+  // inputs smaller than this are not worth splitting across threads
+  static constexpr size_t min_parallel_size = 1 << 12;
+  // cell ranges handed out to pair enumeration threads at a time
+  static constexpr uint32_t cell_batch = 256;
+
+  S min_cell_size;
+  size_t threads;
+
+  std::vector<Circ<T, D>> objects;
+  bool dirty = false;
+
+  // grid (a border of empty cells on every side, so neighbors of filled cells are always in range)
+  S cell_size = 0;
+  S origin[D];
+  uint32_t dims[D];
+  uint32_t strides[D];
+  std::vector<int64_t> forward; // index offsets of the neighbors after a cell (each neighbor pair visited once)
+
+  // cell c holds items[cell_start[c], cell_start[c] + cell_count[c]), up to cell_start[c + 1]
+  std::vector<uint32_t> cell_start, cell_count;
+  std::vector<uint32_t> items;
+  std::vector<uint32_t> cells, slots; // by id: cell and position in items
+
+  std::vector<uint32_t> counts; // per thread and cell (build)
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> found; // per thread (pairs)
+
+  size_t thread_count(size_t work) const {
+    size_t res = threads != 0 ? threads : std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(res, work / min_parallel_size));
+  }
+
+  // runs fn(0..count) on count threads
+  template<class F>
+  static void parallel(size_t count, F fn) {
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+    for (size_t i = 1; i < count; ++i) {
+      workers.emplace_back(fn, i);
+    }
+    fn(0);
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+  }
+
+  // cell holding the center of circ, false if it is outside the grid (or on its border)
+  bool cell_of(const Circ<T, D> &circ, uint32_t &cell) const {
+    cell = 0;
+    for (size_t i = 0; i < D; ++i) {
+      S x = std::floor((S(circ.pos[i]) - origin[i]) / cell_size);
+      if (!(x >= 1 && x < S(dims[i] - 1))) {
+        return false;
+      }
+      cell += uint32_t(x) * strides[i];
+    }
+    return true;
+  }
+
+  void rebuild();
+};
+
+template<class T, dim_t D>
+void UniformGrid<T, D>::rebuild() {
+  dirty = false;
+  size_t n = objects.size();
+  size_t tc = thread_count(n);
+  size_t chunk_size = (n + tc - 1) / tc;
+
+  // bounds of the centers and largest radius
+  std::vector<S> bounds(tc * (2 * D + 1));
+  parallel(tc, [&](size_t t) {
+    S *lo = &bounds[t * (2 * D + 1)], *hi = lo + D, &radius = hi[D];
+    std::fill(lo, hi, std::numeric_limits<S>::infinity());
+    std::fill(hi, hi + D, -std::numeric_limits<S>::infinity());
+    radius = 0;
+    for (size_t id = t * chunk_size; id < std::min(n, (t + 1) * chunk_size); ++id) {
+      for (size_t i = 0; i < D; ++i) {
+        lo[i] = std::min(lo[i], S(objects[id].pos[i]));
+        hi[i] = std::max(hi[i], S(objects[id].pos[i]));
+      }
+      radius = std::max(radius, S(objects[id].radius));
+    }
+  });
+  S lo[D], hi[D], radius = 0;
+  std::fill(lo, lo + D, n ? std::numeric_limits<S>::infinity() : 0);
+  std::fill(hi, hi + D, n ? -std::numeric_limits<S>::infinity() : 0);
+  for (size_t t = 0; t < tc; ++t) {
+    for (size_t i = 0; i < D; ++i) {
+      lo[i] = std::min(lo[i], bounds[t * (2 * D + 1) + i]);
+      hi[i] = std::max(hi[i], bounds[t * (2 * D + 1) + D + i]);
+    }
+    radius = std::max(radius, bounds[t * (2 * D + 1) + 2 * D]);
+  }
+
+  // cells are widened until there are at most about 2 per circle
+  cell_size = std::max(min_cell_size, 2 * radius);
+  if (!(cell_size > 0)) {
+    cell_size = 1;
+  }
+  size_t max_cells = 2 * n + 1024;
+  for (;;) {
+    double total = 1;
+    for (size_t i = 0; i < D; ++i) {
+      // one spare cell per side so small moves stay inside, then one border cell per side
+      dims[i] = uint32_t(std::floor((hi[i] - lo[i]) / cell_size)) + 5;
+      total *= dims[i];
+    }
+    if (total <= double(max_cells)) {
+      break;
+    }
+    cell_size *= 1.5;
+  }
+  size_t cell_total = 1;
+  for (size_t i = 0; i < D; ++i) {
+    origin[i] = lo[i] - cell_size * 2;
+    strides[i] = uint32_t(cell_total);
+    cell_total *= dims[i];
+  }
+
+  // offsets (-1, 0, 1 per axis) whose last nonzero component is positive
+  forward.clear();
+  size_t neighbors = 1;
+  for (size_t i = 0; i < D; ++i) {
+    neighbors *= 3;
+  }
+  for (size_t k = 0; k < neighbors; ++k) {
+    int64_t offset = 0;
+    int last = 0;
+    for (size_t i = 0, rest = k; i < D; ++i, rest /= 3) {
+      int d = int(rest % 3) - 1;
+      offset += d * int64_t(strides[i]);
+      if (d != 0) {
+        last = d;
+      }
+    }
+    if (last > 0) {
+      forward.push_back(offset);
+    }
+  }
+
+  // counting sort: per thread histograms, prefix sums over (cell, thread), then scatter
+  cells.resize(n);
+  slots.resize(n);
+  counts.assign(tc * cell_total, 0);
+  parallel(tc, [&](size_t t) {
+    uint32_t *count = &counts[t * cell_total];
+    for (size_t id = t * chunk_size; id < std::min(n, (t + 1) * chunk_size); ++id) {
+      cell_of(objects[id], cells[id]);
+      ++count[cells[id]];
+    }
+  });
+  cell_start.resize(cell_total + 1);
+  cell_count.resize(cell_total);
+  uint32_t pos = 0;
+  for (size_t c = 0; c < cell_total; ++c) {
+    cell_start[c] = pos;
+    uint32_t total = 0;
+    for (size_t t = 0; t < tc; ++t) {
+      uint32_t count = counts[t * cell_total + c];
+      counts[t * cell_total + c] = pos + total;
+      total += count;
+    }
+    cell_count[c] = total;
+    // spare slots for circles moving in
+    pos += total + total / 4 + 1;
+  }
+  cell_start[cell_total] = pos;
+  items.resize(pos);
+  parallel(tc, [&](size_t t) {
+    uint32_t *next = &counts[t * cell_total];
+    for (size_t id = t * chunk_size; id < std::min(n, (t + 1) * chunk_size); ++id) {
+      slots[id] = next[cells[id]]++;
+      items[slots[id]] = uint32_t(id);
+    }
+  });
+}
+
+template<class T, dim_t D>
+void UniformGrid<T, D>::pairs(std::vector<std::pair<uint32_t, uint32_t>> &out) {
+  out.clear();
+  if (dirty) {
+    rebuild();
+  }
+  uint32_t cell_total = uint32_t(cell_count.size());
+  size_t tc = thread_count(objects.size());
+  found.resize(tc);
+  std::atomic<uint32_t> next_batch = 0;
+  parallel(tc, [&](size_t t) {
+    std::vector<std::pair<uint32_t, uint32_t>> &res = found[t];
+    res.clear();
+    auto report = [&](uint32_t a, uint32_t b) {
+      if (objects[a].intersects(objects[b])) {
+        res.push_back({ std::min(a, b), std::max(a, b) });
+      }
+    };
+    for (;;) {
+      uint32_t first = next_batch.fetch_add(cell_batch, std::memory_order_relaxed);
+      if (first >= cell_total) {
+        break;
+      }
+      for (uint32_t c = first; c < std::min(cell_total, first + cell_batch); ++c) {
+        const uint32_t *a = &items[cell_start[c]], *a_end = a + cell_count[c];
+        for (; a != a_end; ++a) {
+          for (const uint32_t *b = a + 1; b != a_end; ++b) {
+            report(*a, *b);
+          }
+          for (int64_t offset : forward) {
+            uint32_t nc = uint32_t(c + offset);
+            const uint32_t *b = &items[cell_start[nc]], *b_end = b + cell_count[nc];
+            for (; b != b_end; ++b) {
+              report(*a, *b);
+            }
+          }
+        }
+      }
+    }
+  });
+  for (const std::vector<std::pair<uint32_t, uint32_t>> &res : found) {
+    out.insert(out.end(), res.begin(), res.end());
+  }
+}
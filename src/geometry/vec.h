@@ -1,19 +1,56 @@
 #pragma once
 
 #include "../util/iterator.h"
+#include "../util/simd.h"
+#include "../util/fast_math.h"
 #include <stddef.h>
-#include <cstring>
 #include <cmath>
 #include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <type_traits>
 
 using dim_t = uint8_t;
 
+template <class T, dim_t D> class Vec;
+
+// VecExpr - base of Vec and of every lazy Vec expression (CRTP)
+// arithmetic on Vecs builds an expression tree instead of temporaries,
+// the whole tree is then evaluated in one loop when assigned to a Vec
+// operands are held by value (Vecs are small), so expressions never dangle
+
+// E: derived expression type (has a const operator[] returning component i)
+// T: numerical type of the result
+// D: number of dimensions of the result
+template<class E, class T, dim_t D>
+struct VecExpr {
+  constexpr const E &self() const { return static_cast<const E &>(*this); }
+
+  // evaluates expression into a Vec
+  constexpr Vec<T, D> eval() const { return Vec<T, D>(self()); }
+
+  // Vec queries on an unevaluated expression
+  constexpr T x() const { return eval().x(); }
+  constexpr T y() const { return eval().y(); }
+  constexpr T z() const { return eval().z(); }
+  constexpr T w() const { return eval().w(); }
+  constexpr T dot(const Vec<T, D> &other) const { return eval().dot(other); }
+  constexpr T mag_sqd() const { return eval().mag_sqd(); }
+  template<class M = ExactMath>
+  T mag() const { return eval().template mag<M>(); }
+  template<class M = ExactMath>
+  Vec<T, D> norm() const { return eval().template norm<M>(); }
+  constexpr Vec<T, D> proj(const Vec<T, D> &other) const { return eval().proj(other); }
+  constexpr size_t size() const { return D; }
+};
+
 // Vec - represents an mathematical vector
+// trivially copyable and usable in constant expressions
 
 // T: numerical type (int, float, etc.)
 // D: number of dimensions (D >= 1)
 template <class T, dim_t D>
-class Vec {
+class Vec : public VecExpr<Vec<T, D>, T, D> {
   static_assert(D >= 1);
 
   T p[D];
@@ -22,60 +59,53 @@ class Vec {
 public:
   // constructors
   template<class... Args>
-  Vec(Args... comps) {
-    static_assert(sizeof...(comps) == D);
-    size_t i = 0;
-    for (T c : std::initializer_list<std::common_type_t<Args...>>{comps...}) {
-      p[i++] = c;
-    }
-  };
-  Vec() {
+  requires (sizeof...(Args) == D && (std::is_convertible_v<Args, T> && ...))
+  constexpr Vec(Args... comps) : p{static_cast<T>(comps)...} {}
+  constexpr Vec() : p{} {}
+
+  // evaluates expression
+  template<class E>
+  constexpr Vec(const VecExpr<E, T, D> &expr) {
     for (size_t i = 0; i < D; ++i) {
-      p[i] = T{0};
+      p[i] = expr.self()[i];
     }
   }
-  Vec(const Vec<T, D> &other) {
-    *this = other;
-  }
-  Vec(Vec<T, D> &&other) {
-    *this = std::move(other);
-  }
 
-  // assignment
-  Vec &operator=(const Vec<T, D> &other) {
-    memcpy(p, other.p, sizeof(p));
-    return *this;
-  }
-  Vec &operator=(Vec<T, D> &&other) {
-    memmove(p, other.p, sizeof(p));
-    return *this;
+  // comparison
+  constexpr bool operator==(const Vec<T, D> &other) const {
+    for (size_t i = 0; i < D; ++i) {
+      if (p[i] != other[i]) {
+        return false;
+      }
+    }
+    return true;
   }
 
   // index access (first 4: xyzw, w for barycentric coords)
-  const T &operator[](size_t index) const {
+  constexpr const T &operator[](size_t index) const {
     return p[index];
   }
-  T &operator[](size_t index) {
+  constexpr T &operator[](size_t index) {
     return p[index];
   }
-  T x() const {
+  constexpr T x() const {
     return p[0];
   }
-  T y() const {
+  constexpr T y() const {
     static_assert(D >= 2);
     return p[1];
   }
-  T z() const {
+  constexpr T z() const {
     static_assert(D >= 3);
     return p[2];
   }
-  T w() const {
+  constexpr T w() const {
     static_assert(D >= 4);
     return p[3];
   }
 
   // dot product
-  constexpr T dot(Vec<T, D> other) const {
+  constexpr T dot(const Vec<T, D> &other) const {
     T res = T{0};
     for (size_t i = 0; i < D; ++i) {
       res += p[i] * other[i];
@@ -87,31 +117,44 @@ public:
   constexpr T mag_sqd() const {
     return this->dot(*this);
   }
+  // M: math policy (ExactMath or FastMath, see util/fast_math.h)
+  template<class M = ExactMath>
   T mag() const {
-    return std::sqrt(mag_sqd());
+    return M::sqrt(mag_sqd());
   }
 
   // normal
+  template<class M = ExactMath>
   Vec<T, D> norm() const {
-    return *this / mag();
+    if constexpr (M::exact)
+      return *this / mag();
+    else
+      return *this * M::rsqrt(mag_sqd());
   }
 
   // project other onto this
-  constexpr Vec<T, D> proj(Vec<T, D> other) const {
+  constexpr Vec<T, D> proj(const Vec<T, D> &other) const {
     return (this->dot(other) / mag_sqd()) * *this;
   }
 
   // rotation
-  constexpr T angle() const {
+  template<class M = ExactMath>
+  T angle() const {
+    static_assert(D == 2);
+    return M::atan2(p[1], p[0]);
+  }
+
+  // orders like angle() but much cheaper (see pseudo_angle in util/fast_math.h)
+  T pseudo_angle() const {
     static_assert(D == 2);
-    return std::atan2(p[1], p[0]);
+    return ::pseudo_angle(p[1], p[0]);
   }
 
   // TODO: Quaternions (when those are implemented)
 
   // construct new Vec from components
   template<class... Args>
-  Vec<T, sizeof...(Args)> operator()(Args... fmt) {
+  constexpr Vec<T, sizeof...(Args)> operator()(Args... fmt) const {
     Vec<T, sizeof...(fmt)> res;
     size_t i = 0;
     for (size_t j : std::initializer_list<std::common_type_t<Args...>>{fmt...}) {
@@ -122,121 +165,357 @@ public:
 
   Iterator begin() { return Iterator(p); }
   Iterator end() { return Iterator(p + D); }
-  size_t size() const { return D; }
+  constexpr size_t size() const { return D; }
 };
 
-// operators
+// float and double Vecs of 2 to 4 dimensions are stored padded to 2 or 4 lanes and aligned,
+// so each one is a single SIMD register (util/simd.h)
+// arithmetic is done directly on registers (no expression nodes, a temporary is just a register)
+// padding lanes are always 0 so horizontal sums (dot, mag, norm) can include them
 template<class T, dim_t D>
-constexpr Vec<T, D> operator*(Vec<T, D> lhs, Vec<T, D> rhs) {
-  for (size_t i = 0; i < D; ++i) {
-    lhs[i] *= rhs[i];
+concept SimdVecType = D >= 2 && D <= 4 && SimdLanes<T, D == 3 ? 4 : D>::enabled;
+
+template <class T, dim_t D>
+requires SimdVecType<T, D>
+class Vec<T, D> : public VecExpr<Vec<T, D>, T, D> {
+  static constexpr size_t W = D == 3 ? 4 : D; // padded size
+  using R = SimdLanes<T, W>;
+  using reg = typename R::reg;
+
+  alignas(W * sizeof(T)) T p[W];
+
+  using Iterator = ArrayIterator<T>;
+public:
+  // constructors
+  template<class... Args>
+  requires (sizeof...(Args) == D && (std::is_convertible_v<Args, T> && ...))
+  constexpr Vec(Args... comps) : p{static_cast<T>(comps)...} {}
+  constexpr Vec() : p{} {}
+
+  // evaluates expression
+  template<class E>
+  constexpr Vec(const VecExpr<E, T, D> &expr) : p{} {
+    for (size_t i = 0; i < D; ++i) {
+      p[i] = expr.self()[i];
+    }
   }
-  return lhs;
-}
-template<class T, dim_t D>
-constexpr Vec<T, D> operator*(Vec<T, D> lhs, T rhs) {
-  for (size_t i = 0; i < D; ++i) {
-    lhs[i] *= rhs;
+
+  // comparison
+  constexpr bool operator==(const Vec<T, D> &other) const {
+    for (size_t i = 0; i < D; ++i) {
+      if (p[i] != other[i]) {
+        return false;
+      }
+    }
+    return true;
   }
-  return lhs;
-}
+
+  // index access (first 4: xyzw, w for barycentric coords)
+  constexpr const T &operator[](size_t index) const {
+    return p[index];
+  }
+  constexpr T &operator[](size_t index) {
+    return p[index];
+  }
+  constexpr T x() const {
+    return p[0];
+  }
+  constexpr T y() const {
+    return p[1];
+  }
+  constexpr T z() const {
+    static_assert(D >= 3);
+    return p[2];
+  }
+  constexpr T w() const {
+    static_assert(D >= 4);
+    return p[3];
+  }
+
+  // dot product
+  constexpr T dot(const Vec<T, D> &other) const {
+    if (std::is_constant_evaluated()) {
+      T res = T{0};
+      for (size_t i = 0; i < D; ++i) {
+        res += p[i] * other[i];
+      }
+      return res;
+    }
+    return R::first(R::hsum(R::mul(load(), other.load())));
+  }
+
+  // magnitude
+  constexpr T mag_sqd() const {
+    return this->dot(*this);
+  }
+  // M: math policy (ExactMath or FastMath, see util/fast_math.h)
+  template<class M = ExactMath>
+  T mag() const {
+    return M::sqrt(mag_sqd());
+  }
+
+  // normal (squared magnitude is summed into every lane, so no scalar round trip)
+  template<class M = ExactMath>
+  Vec<T, D> norm() const {
+    if constexpr (M::exact) {
+      reg v = load();
+      return from(R::div(v, R::sqrt(R::hsum(R::mul(v, v)))), true);
+    } else
+      return *this * M::rsqrt(mag_sqd());
+  }
+
+  // project other onto this
+  constexpr Vec<T, D> proj(const Vec<T, D> &other) const {
+    return (this->dot(other) / mag_sqd()) * *this;
+  }
+
+  // rotation
+  template<class M = ExactMath>
+  T angle() const {
+    static_assert(D == 2);
+    return M::atan2(p[1], p[0]);
+  }
+
+  // orders like angle() but much cheaper (see pseudo_angle in util/fast_math.h)
+  T pseudo_angle() const {
+    static_assert(D == 2);
+    return ::pseudo_angle(p[1], p[0]);
+  }
+
+  // construct new Vec from components
+  template<class... Args>
+  constexpr Vec<T, sizeof...(Args)> operator()(Args... fmt) const {
+    Vec<T, sizeof...(fmt)> res;
+    size_t i = 0;
+    for (size_t j : std::initializer_list<std::common_type_t<Args...>>{fmt...}) {
+      res[i++] = p[j];
+    }
+    return res;
+  }
+
+  Iterator begin() { return Iterator(p); }
+  Iterator end() { return Iterator(p + D); }
+  constexpr size_t size() const { return D; }
+
+  // operators
+  friend constexpr Vec operator*(const Vec &lhs, const Vec &rhs) {
+    return lanewise(lhs, rhs, R::mul, [](T a, T b) { return a * b; });
+  }
+  friend constexpr Vec operator*(const Vec &lhs, T rhs) {
+    return lanewise(lhs, rhs, R::mul, [](T a, T b) { return a * b; }, true);
+  }
+  friend constexpr Vec operator*(T lhs, const Vec &rhs) {
+    return rhs * lhs;
+  }
+  friend constexpr Vec operator/(const Vec &lhs, const Vec &rhs) {
+    return lanewise(lhs, rhs, R::div, [](T a, T b) { return a / b; }, true);
+  }
+  friend constexpr Vec operator/(const Vec &lhs, T rhs) {
+    return lanewise(lhs, rhs, R::div, [](T a, T b) { return a / b; }, true);
+  }
+  friend constexpr Vec operator+(const Vec &lhs, const Vec &rhs) {
+    return lanewise(lhs, rhs, R::add, [](T a, T b) { return a + b; });
+  }
+  friend constexpr Vec operator-(const Vec &lhs, const Vec &rhs) {
+    return lanewise(lhs, rhs, R::sub, [](T a, T b) { return a - b; });
+  }
+  friend constexpr Vec operator-(const Vec &v) {
+    if (std::is_constant_evaluated()) {
+      Vec res;
+      for (size_t i = 0; i < D; ++i) {
+        res[i] = -v[i];
+      }
+      return res;
+    }
+    return from(R::neg(v.load()));
+  }
+
+  friend constexpr Vec &operator*=(Vec &lhs, const Vec &rhs) { return lhs = lhs * rhs; }
+  friend constexpr Vec &operator*=(Vec &lhs, T rhs) { return lhs = lhs * rhs; }
+  friend constexpr Vec &operator/=(Vec &lhs, const Vec &rhs) { return lhs = lhs / rhs; }
+  friend constexpr Vec &operator/=(Vec &lhs, T rhs) { return lhs = lhs / rhs; }
+  friend constexpr Vec &operator+=(Vec &lhs, const Vec &rhs) { return lhs = lhs + rhs; }
+  friend constexpr Vec &operator+=(Vec &lhs, T rhs) {
+    return lhs = lanewise(lhs, rhs, R::add, [](T a, T b) { return a + b; }, true);
+  }
+  friend constexpr Vec &operator-=(Vec &lhs, const Vec &rhs) { return lhs = lhs - rhs; }
+  friend constexpr Vec &operator-=(Vec &lhs, T rhs) {
+    return lhs = lanewise(lhs, rhs, R::sub, [](T a, T b) { return a - b; }, true);
+  }
+private:
+  reg load() const { return R::load(p); }
+
+  // stores register into a Vec
+  // mask must be set if op could have made the padding lane nonzero (ex: 0 / 0)
+  static Vec from(reg r, bool mask = false) {
+    Vec res;
+    if constexpr (W != D) {
+      if (mask)
+        r = R::keep(r, D);
+    }
+    R::store(res.p, r);
+    return res;
+  }
+
+  // applies op to each component (register op at runtime, scalar op in constant expressions)
+  template<class ScalarOp>
+  static constexpr Vec lanewise(const Vec &lhs, const Vec &rhs, reg (*op)(reg, reg), ScalarOp scalar_op, bool mask = false) {
+    if (std::is_constant_evaluated()) {
+      Vec res;
+      for (size_t i = 0; i < D; ++i) {
+        res[i] = scalar_op(lhs[i], rhs[i]);
+      }
+      return res;
+    }
+    return from(op(lhs.load(), rhs.load()), mask);
+  }
+  template<class ScalarOp>
+  static constexpr Vec lanewise(const Vec &lhs, T rhs, reg (*op)(reg, reg), ScalarOp scalar_op, bool mask = false) {
+    if (std::is_constant_evaluated()) {
+      Vec res;
+      for (size_t i = 0; i < D; ++i) {
+        res[i] = scalar_op(lhs[i], rhs);
+      }
+      return res;
+    }
+    return from(op(lhs.load(), R::set1(rhs)), mask);
+  }
+};
+
+// expression nodes
+// scalar broadcast to every component
 template<class T, dim_t D>
-constexpr Vec<T, D> operator*(T lhs, Vec<T, D> rhs) {
-  return rhs * lhs;
+struct VecScalarExpr : VecExpr<VecScalarExpr<T, D>, T, D> {
+  T value;
+
+  constexpr VecScalarExpr(T value) : value(value) {}
+  constexpr T operator[](size_t) const { return value; }
+};
+
+// component-wise Op(a[i])
+template<class A, class Op, class T, dim_t D>
+struct VecUnaryExpr : VecExpr<VecUnaryExpr<A, Op, T, D>, T, D> {
+  A a;
+
+  constexpr VecUnaryExpr(const A &a) : a(a) {}
+  constexpr T operator[](size_t i) const { return static_cast<T>(Op{}(a[i])); }
+};
+
+// component-wise Op(a[i], b[i])
+template<class A, class B, class Op, class T, dim_t D>
+struct VecBinaryExpr : VecExpr<VecBinaryExpr<A, B, Op, T, D>, T, D> {
+  A a;
+  B b;
+
+  constexpr VecBinaryExpr(const A &a, const B &b) : a(a), b(b) {}
+  constexpr T operator[](size_t i) const { return static_cast<T>(Op{}(a[i], b[i])); }
+};
+
+template<class Op, class A, class B, class T, dim_t D>
+constexpr VecBinaryExpr<A, B, Op, T, D> make_vec_expr(const VecExpr<A, T, D> &a, const VecExpr<B, T, D> &b) {
+  return { a.self(), b.self() };
+}
+template<class Op, class A, class T, dim_t D>
+constexpr VecBinaryExpr<A, VecScalarExpr<T, D>, Op, T, D> make_vec_expr(const VecExpr<A, T, D> &a, T b) {
+  return { a.self(), VecScalarExpr<T, D>(b) };
+}
+template<class Op, class B, class T, dim_t D>
+constexpr VecBinaryExpr<VecScalarExpr<T, D>, B, Op, T, D> make_vec_expr(T a, const VecExpr<B, T, D> &b) {
+  return { VecScalarExpr<T, D>(a), b.self() };
 }
 
-template<class T, dim_t D>
-constexpr Vec<T, D> operator/(Vec<T, D> lhs, Vec<T, D> rhs) {
-  for (size_t i = 0; i < D; ++i) {
-    lhs[i] /= rhs[i];
-  }
-  return lhs;
+// operators (lazy, evaluated when converted to a Vec)
+template<class A, class B, class T, dim_t D>
+constexpr auto operator*(const VecExpr<A, T, D> &lhs, const VecExpr<B, T, D> &rhs) {
+  return make_vec_expr<std::multiplies<>>(lhs, rhs);
 }
-template<class T, dim_t D>
-constexpr Vec<T, D> operator/(Vec<T, D> lhs, T rhs) {
-  for (size_t i = 0; i < D; ++i) {
-    lhs[i] /= rhs;
-  }
-  return lhs;
+template<class A, class T, dim_t D>
+constexpr auto operator*(const VecExpr<A, T, D> &lhs, std::type_identity_t<T> rhs) {
+  return make_vec_expr<std::multiplies<>>(lhs, rhs);
+}
+template<class B, class T, dim_t D>
+constexpr auto operator*(std::type_identity_t<T> lhs, const VecExpr<B, T, D> &rhs) {
+  return make_vec_expr<std::multiplies<>>(lhs, rhs);
 }
 
-template<class T, dim_t D>
-constexpr Vec<T, D> operator+(Vec<T, D> lhs, Vec<T, D> rhs) {
-  for (size_t i = 0; i < D; ++i) {
-    lhs[i] += rhs[i];
-  }
-  return lhs;
+template<class A, class B, class T, dim_t D>
+constexpr auto operator/(const VecExpr<A, T, D> &lhs, const VecExpr<B, T, D> &rhs) {
+  return make_vec_expr<std::divides<>>(lhs, rhs);
+}
+template<class A, class T, dim_t D>
+constexpr auto operator/(const VecExpr<A, T, D> &lhs, std::type_identity_t<T> rhs) {
+  return make_vec_expr<std::divides<>>(lhs, rhs);
 }
 
-template<class T, dim_t D>
-constexpr Vec<T, D> operator-(Vec<T, D> v) {
-  for (size_t i = 0; i < D; ++i) {
-    v[i] = -v[i];
-  }
-  return v;
+template<class A, class B, class T, dim_t D>
+constexpr auto operator+(const VecExpr<A, T, D> &lhs, const VecExpr<B, T, D> &rhs) {
+  return make_vec_expr<std::plus<>>(lhs, rhs);
 }
-template<class T, dim_t D>
-constexpr Vec<T, D> operator-(Vec<T, D> lhs, Vec<T, D> rhs) {
-  for (size_t i = 0; i < D; ++i) {
-    lhs[i] -= rhs[i];
-  }
-  return lhs;
+
+template<class A, class T, dim_t D>
+constexpr auto operator-(const VecExpr<A, T, D> &v) {
+  return VecUnaryExpr<A, std::negate<>, T, D>(v.self());
+}
+template<class A, class B, class T, dim_t D>
+constexpr auto operator-(const VecExpr<A, T, D> &lhs, const VecExpr<B, T, D> &rhs) {
+  return make_vec_expr<std::minus<>>(lhs, rhs);
 }
 
-template<class T, dim_t D>
-constexpr Vec<T, D> &operator*=(Vec<T, D> &lhs, Vec<T, D> rhs) {
+// compound assignment (evaluates rhs directly into lhs)
+template<class T, dim_t D, class B>
+constexpr Vec<T, D> &operator*=(Vec<T, D> &lhs, const VecExpr<B, T, D> &rhs) {
   for (size_t i = 0; i < D; ++i) {
-    lhs[i] *= rhs[i];
+    lhs[i] *= rhs.self()[i];
   }
   return lhs;
 }
 template<class T, dim_t D>
-constexpr Vec<T, D> &operator*=(Vec<T, D> &lhs, T rhs) {
+constexpr Vec<T, D> &operator*=(Vec<T, D> &lhs, std::type_identity_t<T> rhs) {
   for (size_t i = 0; i < D; ++i) {
     lhs[i] *= rhs;
   }
   return lhs;
 }
 
-template<class T, dim_t D>
-constexpr Vec<T, D> &operator/=(Vec<T, D> &lhs, Vec<T, D> rhs) {
+template<class T, dim_t D, class B>
+constexpr Vec<T, D> &operator/=(Vec<T, D> &lhs, const VecExpr<B, T, D> &rhs) {
   for (size_t i = 0; i < D; ++i) {
-    lhs[i] /= rhs[i];
+    lhs[i] /= rhs.self()[i];
   }
   return lhs;
 }
 template<class T, dim_t D>
-constexpr Vec<T, D> &operator/=(Vec<T, D> &lhs, T rhs) {
+constexpr Vec<T, D> &operator/=(Vec<T, D> &lhs, std::type_identity_t<T> rhs) {
   for (size_t i = 0; i < D; ++i) {
     lhs[i] /= rhs;
   }
   return lhs;
 }
 
-template<class T, dim_t D>
-constexpr Vec<T, D> &operator+=(Vec<T, D> &lhs, Vec<T, D> rhs) {
+template<class T, dim_t D, class B>
+constexpr Vec<T, D> &operator+=(Vec<T, D> &lhs, const VecExpr<B, T, D> &rhs) {
   for (size_t i = 0; i < D; ++i) {
-    lhs[i] += rhs[i];
+    lhs[i] += rhs.self()[i];
   }
   return lhs;
 }
 template<class T, dim_t D>
-constexpr Vec<T, D> &operator+=(Vec<T, D> &lhs, T rhs) {
+constexpr Vec<T, D> &operator+=(Vec<T, D> &lhs, std::type_identity_t<T> rhs) {
   for (size_t i = 0; i < D; ++i) {
     lhs[i] += rhs;
   }
   return lhs;
 }
 
-template<class T, dim_t D>
-constexpr Vec<T, D> &operator-=(Vec<T, D> &lhs, Vec<T, D> rhs) {
+template<class T, dim_t D, class B>
+constexpr Vec<T, D> &operator-=(Vec<T, D> &lhs, const VecExpr<B, T, D> &rhs) {
   for (size_t i = 0; i < D; ++i) {
-    lhs[i] -= rhs[i];
+    lhs[i] -= rhs.self()[i];
   }
   return lhs;
 }
 template<class T, dim_t D>
-constexpr Vec<T, D> &operator-=(Vec<T, D> &lhs, T rhs) {
+constexpr Vec<T, D> &operator-=(Vec<T, D> &lhs, std::type_identity_t<T> rhs) {
   for (size_t i = 0; i < D; ++i) {
     lhs[i] -= rhs;
   }
@@ -259,3 +538,5 @@ using Vec3d = Vec3<double>;
 using Vec4i = Vec4<int>;
 using Vec4f = Vec4<float>;
 using Vec4d = Vec4<double>;
+
+static_assert(std::is_trivially_copyable_v<Vec3f>);
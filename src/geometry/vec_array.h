@@ -0,0 +1,259 @@
+#pragma once
+
+#include "vec.h"
+#include "../util/simd.h"
+#include <stddef.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// VecArray - array of Vecs stored as structure of arrays (one contiguous array per component)
+// batch operations run over whole component arrays with SIMD kernels (util/simd.h)
+
+// T: numerical type (int, float, etc.)
+// D: number of dimensions (D >= 1)
+template<class T, dim_t D>
+class VecArray {
+  static_assert(D >= 1);
+
+  std::vector<T> comps[D];
+
+  using Kernels = Batch<T>;
+public:
+  // view of one element, reads and writes go straight to the component arrays
+  struct VecRef {
+    VecArray *arr;
+    size_t index;
+
+    T &operator[](size_t d) const { return arr->comps[d][index]; }
+    operator Vec<T, D>() const { return arr->get(index); }
+    VecRef &operator=(const Vec<T, D> &v) {
+      arr->set(index, v);
+      return *this;
+    }
+  };
+
+  // constructors
+  VecArray() {}
+  VecArray(size_t n) {
+    resize(n);
+  }
+  VecArray(const std::vector<Vec<T, D>> &vecs) {
+    reserve(vecs.size());
+    for (const Vec<T, D> &v : vecs)
+      push_back(v);
+  }
+
+  // conversion back to array of structs
+  std::vector<Vec<T, D>> to_vecs() const {
+    std::vector<Vec<T, D>> res(size());
+    for (size_t i = 0; i < size(); ++i)
+      res[i] = get(i);
+    return res;
+  }
+
+  size_t size() const { return comps[0].size(); }
+  void resize(size_t n) {
+    for (dim_t d = 0; d < D; ++d)
+      comps[d].resize(n);
+  }
+  void reserve(size_t n) {
+    for (dim_t d = 0; d < D; ++d)
+      comps[d].reserve(n);
+  }
+  void clear() {
+    for (dim_t d = 0; d < D; ++d)
+      comps[d].clear();
+  }
+  void push_back(const Vec<T, D> &v) {
+    for (dim_t d = 0; d < D; ++d)
+      comps[d].push_back(v[d]);
+  }
+
+  // element access
+  Vec<T, D> get(size_t index) const {
+    Vec<T, D> res;
+    for (dim_t d = 0; d < D; ++d)
+      res[d] = comps[d][index];
+    return res;
+  }
+  void set(size_t index, const Vec<T, D> &v) {
+    for (dim_t d = 0; d < D; ++d)
+      comps[d][index] = v[d];
+  }
+  VecRef operator[](size_t index) { return { this, index }; }
+  Vec<T, D> operator[](size_t index) const { return get(index); }
+
+  // raw component arrays (size() elements each)
+  T *component(dim_t d) { return comps[d].data(); }
+  const T *component(dim_t d) const { return comps[d].data(); }
+
+  // element-wise operators (other must have the same size)
+  VecArray &operator+=(const VecArray &other) { return apply(other, Kernels::add); }
+  VecArray &operator-=(const VecArray &other) { return apply(other, Kernels::sub); }
+  VecArray &operator*=(const VecArray &other) { return apply(other, Kernels::mul); }
+  VecArray &operator/=(const VecArray &other) { return apply(other, Kernels::div); }
+
+  // operators with the same Vec for every element
+  VecArray &operator+=(const Vec<T, D> &v) { return apply(v, Kernels::add); }
+  VecArray &operator-=(const Vec<T, D> &v) { return apply(v, Kernels::sub); }
+  VecArray &operator*=(const Vec<T, D> &v) { return apply(v, Kernels::mul); }
+  VecArray &operator/=(const Vec<T, D> &v) { return apply(v, Kernels::div); }
+
+  // operators with a scalar
+  VecArray &operator*=(T s) { return apply(s, Kernels::mul); }
+  VecArray &operator/=(T s) { return apply(s, Kernels::div); }
+
+  // dot product of each element with the matching element of other
+  std::vector<T> dot(const VecArray &other) const {
+    std::vector<T> res(size(), T{0});
+    for (dim_t d = 0; d < D; ++d)
+      Kernels::mul_add(comps[d].data(), other.comps[d].data(), res.data(), size());
+    return res;
+  }
+
+  // dot product of each element with v
+  std::vector<T> dot(const Vec<T, D> &v) const {
+    std::vector<T> res(size(), T{0});
+    for (dim_t d = 0; d < D; ++d)
+      Kernels::mul_add(comps[d].data(), v[d], res.data(), size());
+    return res;
+  }
+
+  // magnitude of each element
+  std::vector<T> mag_sqd() const {
+    return dot(*this);
+  }
+  // M: math policy (ExactMath or FastMath, see util/fast_math.h)
+  template<class M = ExactMath>
+  std::vector<T> mag() const {
+    std::vector<T> res = mag_sqd();
+    M::sqrt(res.data(), res.data(), size());
+    return res;
+  }
+
+  // normalizes every element in place
+  template<class M = ExactMath>
+  void normalize() {
+    if constexpr (M::exact) {
+      std::vector<T> mags = mag();
+      for (dim_t d = 0; d < D; ++d)
+        Kernels::div(comps[d].data(), mags.data(), comps[d].data(), size());
+    } else {
+      std::vector<T> scale = mag_sqd();
+      M::rsqrt(scale.data(), scale.data(), size());
+      for (dim_t d = 0; d < D; ++d)
+        Kernels::mul(comps[d].data(), scale.data(), comps[d].data(), size());
+    }
+  }
+  template<class M = ExactMath>
+  VecArray norm() const {
+    VecArray res = *this;
+    res.template normalize<M>();
+    return res;
+  }
+
+  // angle of each element (D == 2)
+  template<class M = ExactMath>
+  std::vector<T> angle() const {
+    static_assert(D == 2);
+    std::vector<T> res(size());
+    M::atan2(comps[1].data(), comps[0].data(), res.data(), size());
+    return res;
+  }
+
+  // pseudo angle of each element (D == 2), orders like angle()
+  std::vector<T> pseudo_angle() const {
+    static_assert(D == 2);
+    std::vector<T> res(size());
+    for (size_t i = 0; i < size(); ++i)
+      res[i] = ::pseudo_angle(comps[1][i], comps[0][i]);
+    return res;
+  }
+
+  // projects each element of other onto the matching element of this
+  VecArray proj(const VecArray &other) const {
+    std::vector<T> scale = dot(other);
+    std::vector<T> mags = mag_sqd();
+    Kernels::div(scale.data(), mags.data(), scale.data(), size());
+    VecArray res = *this;
+    for (dim_t d = 0; d < D; ++d)
+      Kernels::mul(res.comps[d].data(), scale.data(), res.comps[d].data(), size());
+    return res;
+  }
+
+  // projects each element onto v
+  VecArray proj_onto(const Vec<T, D> &v) const {
+    std::vector<T> scale = dot(v);
+    Kernels::div(scale.data(), v.mag_sqd(), scale.data(), size());
+    VecArray res(size());
+    for (dim_t d = 0; d < D; ++d)
+      Kernels::mul(scale.data(), v[d], res.comps[d].data(), size());
+    return res;
+  }
+
+  // component-wise min/max over all elements (array must not be empty)
+  Vec<T, D> min() const {
+    Vec<T, D> res;
+    for (dim_t d = 0; d < D; ++d)
+      res[d] = Kernels::min(comps[d].data(), size());
+    return res;
+  }
+  Vec<T, D> max() const {
+    Vec<T, D> res;
+    for (dim_t d = 0; d < D; ++d)
+      res[d] = Kernels::max(comps[d].data(), size());
+    return res;
+  }
+
+  // axis aligned bounding box as (min corner, max corner)
+  std::pair<Vec<T, D>, Vec<T, D>> aabb() const {
+    return { min(), max() };
+  }
+private:
+  VecArray &apply(const VecArray &other, void (*kernel)(const T *, const T *, T *, size_t)) {
+    for (dim_t d = 0; d < D; ++d)
+      kernel(comps[d].data(), other.comps[d].data(), comps[d].data(), size());
+    return *this;
+  }
+  VecArray &apply(const Vec<T, D> &v, void (*kernel)(const T *, T, T *, size_t)) {
+    for (dim_t d = 0; d < D; ++d)
+      kernel(comps[d].data(), v[d], comps[d].data(), size());
+    return *this;
+  }
+  VecArray &apply(T s, void (*kernel)(const T *, T, T *, size_t)) {
+    for (dim_t d = 0; d < D; ++d)
+      kernel(comps[d].data(), s, comps[d].data(), size());
+    return *this;
+  }
+};
+
+// operators
+template<class T, dim_t D>
+VecArray<T, D> operator+(VecArray<T, D> lhs, const VecArray<T, D> &rhs) { return lhs += rhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator-(VecArray<T, D> lhs, const VecArray<T, D> &rhs) { return lhs -= rhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator*(VecArray<T, D> lhs, const VecArray<T, D> &rhs) { return lhs *= rhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator/(VecArray<T, D> lhs, const VecArray<T, D> &rhs) { return lhs /= rhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator+(VecArray<T, D> lhs, const Vec<T, D> &rhs) { return lhs += rhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator-(VecArray<T, D> lhs, const Vec<T, D> &rhs) { return lhs -= rhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator*(VecArray<T, D> lhs, T rhs) { return lhs *= rhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator*(T lhs, VecArray<T, D> rhs) { return rhs *= lhs; }
+template<class T, dim_t D>
+VecArray<T, D> operator/(VecArray<T, D> lhs, T rhs) { return lhs /= rhs; }
+
+// shorthands
+template<class T>
+using VecArray2 = VecArray<T, 2>;
+template<class T>
+using VecArray3 = VecArray<T, 3>;
+using VecArray2f = VecArray2<float>;
+using VecArray2d = VecArray2<double>;
+using VecArray3f = VecArray3<float>;
+using VecArray3d = VecArray3<double>;
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <stddef.h>
+#include <cstdint>
+#include <array>
+#include <limits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 // T: element type (must be copyable, must have default constructor)
 // N: number of children per node
@@ -20,6 +25,320 @@ private:
   NaryNode<T, N> *next[N] = {};
 };
 
+enum class TreeLayout {
+  Pool,       // nodes wherever they were allocated, explicit child indices
+  Eytzinger,  // breadth-first order with implicit children (node i has children N * i + 1 ... N * i + N)
+  VanEmdeBoas // recursive halving of the height, explicit child indices
+};
+
+// Tree owning its nodes in a contiguous pool, nodes are referred to by 32-bit indices
+// freed nodes are reused (free list threaded through their first child index), clear destroys everything at once
+// traversals are iterative (explicit stack or queue), so deep trees do not overflow the call stack
+// T: element type (must be copyable, must have default constructor)
+// N: number of children per node
+template<class T = int, size_t N = 2>
+class NaryTree {
+  static_assert(N >= 1);
+public:
+  using index = uint32_t;
+  static constexpr index none = std::numeric_limits<index>::max();
+
+  // new node without a parent, it becomes the root if the tree is empty
+  index add(const T &val) {
+    index node = alloc(val);
+    if (root_node == none) {
+      root_node = node;
+    }
+    return node;
+  }
+
+  // new node in the (empty) child slot of parent
+  index add(index parent, size_t child, const T &val) {
+    index node = alloc(val);
+    links[parent][child] = node;
+    return node;
+  }
+
+  // links node (none to unlink) into the child slot of parent, the previous child is not freed
+  void set_child(index parent, size_t child, index node) {
+    to_pool();
+    links[parent][child] = node;
+  }
+  void set_root(index node) { root_node = node; }
+
+  // unlinks the child subtree of parent and frees its nodes
+  void erase(index parent, size_t child) {
+    to_pool();
+    index node = links[parent][child];
+    links[parent][child] = none;
+    free_subtree(node);
+  }
+
+  // destroys all nodes (the pool keeps its memory)
+  void clear() {
+    vals.clear();
+    links.clear();
+    free_head = root_node = none;
+    count = 0;
+    order = TreeLayout::Pool;
+  }
+
+  void reserve(size_t n) {
+    vals.reserve(n);
+    links.reserve(n);
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  index root() const { return root_node; }
+  TreeLayout layout() const { return order; }
+
+  T &operator[](index node) { return vals[node]; }
+  const T &operator[](index node) const { return vals[node]; }
+
+  index child(index node, size_t i) const {
+    if (order == TreeLayout::Eytzinger) {
+      size_t res = N * size_t(node) + 1 + i;
+      return res < vals.size() ? index(res) : none;
+    }
+    return links[node][i];
+  }
+  index left(index node) const { return child(node, 0); }
+  index right(index node) const { return child(node, N - 1); }
+
+  // fn(index) on every node reachable from the root
+  // in-order visits a node between its first and second child
+  template<class F>
+  void preorder(F fn) const { depth_first(fn, 0); }
+  template<class F>
+  void inorder(F fn) const { depth_first(fn, 1); }
+  template<class F>
+  void postorder(F fn) const { depth_first(fn, N); }
+  template<class F>
+  void bfs(F fn) const;
+
+  // renumbers the nodes reachable from the root (which becomes 0) into target, dropping the rest and the free list
+  // earlier indices are invalid afterwards
+  // Eytzinger stores no child indices but needs a complete tree (every level full except the last, filled from
+  // the left), false otherwise (the tree is left unchanged), structural changes turn it back into a pool
+  bool relayout(TreeLayout target);
+private:
+  using Links = std::array<index, N>;
+
+  std::vector<T> vals;
+  std::vector<Links> links; // empty in the Eytzinger layout
+  index free_head = none;
+  index root_node = none;
+  size_t count = 0;
+  TreeLayout order = TreeLayout::Pool;
+
+  index alloc(const T &val) {
+    to_pool();
+    index node;
+    if (free_head != none) {
+      node = free_head;
+      free_head = links[node][0];
+      vals[node] = val;
+    } else {
+      node = index(vals.size());
+      vals.push_back(val);
+      links.emplace_back();
+    }
+    links[node].fill(none);
+    ++count;
+    return node;
+  }
+
+  void free_subtree(index node) {
+    std::vector<index> stack;
+    if (node != none) {
+      stack.push_back(node);
+    }
+    while (!stack.empty()) {
+      node = stack.back();
+      stack.pop_back();
+      for (index c : links[node]) {
+        if (c != none) {
+          stack.push_back(c);
+        }
+      }
+      vals[node] = T();
+      links[node][0] = free_head;
+      free_head = node;
+      --count;
+    }
+  }
+
+  // restores explicit child indices
+  void to_pool() {
+    if (order != TreeLayout::Eytzinger) {
+      return;
+    }
+    links.resize(vals.size());
+    for (size_t i = 0; i < links.size(); ++i) {
+      for (size_t k = 0; k < N; ++k) {
+        links[i][k] = child(index(i), k);
+      }
+    }
+    order = TreeLayout::Pool;
+  }
+
+  // visits each node once its first pos children are done
+  template<class F>
+  void depth_first(F &fn, size_t pos) const;
+
+  // appends the van Emde Boas order of the subtree of node cut to height levels
+  void veb_order(index node, size_t height, std::vector<index> &out) const;
+  size_t height() const;
+};
+
+template<class T, size_t N>
+template<class F>
+void NaryTree<T, N>::depth_first(F &fn, size_t pos) const {
+  // node and the next child to descend into
+  std::vector<std::pair<index, size_t>> stack;
+  if (root_node != none) {
+    stack.push_back({ root_node, 0 });
+  }
+  while (!stack.empty()) {
+    auto [node, next] = stack.back();
+    if (next == pos) {
+      fn(node);
+    }
+    if (next == N) {
+      stack.pop_back();
+      continue;
+    }
+    ++stack.back().second;
+    index c = child(node, next);
+    if (c != none) {
+      stack.push_back({ c, 0 });
+    }
+  }
+}
+
+template<class T, size_t N>
+template<class F>
+void NaryTree<T, N>::bfs(F fn) const {
+  std::vector<index> queue;
+  if (root_node != none) {
+    queue.push_back(root_node);
+  }
+  for (size_t head = 0; head < queue.size(); ++head) {
+    fn(queue[head]);
+    for (size_t k = 0; k < N; ++k) {
+      index c = child(queue[head], k);
+      if (c != none) {
+        queue.push_back(c);
+      }
+    }
+  }
+}
+
+template<class T, size_t N>
+size_t NaryTree<T, N>::height() const {
+  size_t res = 0;
+  std::vector<index> level, next;
+  if (root_node != none) {
+    level.push_back(root_node);
+  }
+  for (; !level.empty(); ++res) {
+    next.clear();
+    for (index node : level) {
+      for (size_t k = 0; k < N; ++k) {
+        index c = child(node, k);
+        if (c != none) {
+          next.push_back(c);
+        }
+      }
+    }
+    level.swap(next);
+  }
+  return res;
+}
+
+template<class T, size_t N>
+void NaryTree<T, N>::veb_order(index node, size_t height, std::vector<index> &out) const {
+  if (height == 1) {
+    out.push_back(node);
+    return;
+  }
+  // top half, then the subtrees hanging below it from left to right
+  size_t top = height / 2;
+  veb_order(node, top, out);
+  std::vector<std::pair<index, size_t>> stack = { { node, 0 } };
+  while (!stack.empty()) {
+    auto [cur, depth] = stack.back();
+    stack.pop_back();
+    if (depth == top) {
+      veb_order(cur, height - top, out);
+      continue;
+    }
+    for (size_t k = N; k-- > 0;) {
+      index c = child(cur, k);
+      if (c != none) {
+        stack.push_back({ c, depth + 1 });
+      }
+    }
+  }
+}
+
+template<class T, size_t N>
+bool NaryTree<T, N>::relayout(TreeLayout target) {
+  std::vector<index> seq;
+  seq.reserve(count);
+  if (target == TreeLayout::Eytzinger) {
+    // complete iff no child slot is filled after an empty one in breadth-first order
+    bool gap = false, complete = true;
+    bfs([&](index node) {
+      seq.push_back(node);
+      for (size_t k = 0; k < N; ++k) {
+        bool filled = child(node, k) != none;
+        complete &= !(gap && filled);
+        gap |= !filled;
+      }
+    });
+    if (!complete) {
+      return false;
+    }
+  } else if (target == TreeLayout::VanEmdeBoas) {
+    if (root_node != none) {
+      veb_order(root_node, height(), seq);
+    }
+  } else {
+    preorder([&](index node) { seq.push_back(node); });
+  }
+
+  std::vector<index> ids(vals.size(), none);
+  for (size_t i = 0; i < seq.size(); ++i) {
+    ids[seq[i]] = index(i);
+  }
+  std::vector<T> new_vals;
+  std::vector<Links> new_links;
+  new_vals.reserve(seq.size());
+  if (target != TreeLayout::Eytzinger) {
+    new_links.reserve(seq.size());
+  }
+  for (index node : seq) {
+    new_vals.push_back(std::move(vals[node]));
+    if (target != TreeLayout::Eytzinger) {
+      Links l;
+      for (size_t k = 0; k < N; ++k) {
+        index c = child(node, k);
+        l[k] = c != none ? ids[c] : none;
+      }
+      new_links.push_back(l);
+    }
+  }
+  vals.swap(new_vals);
+  links.swap(new_links);
+  free_head = none;
+  root_node = seq.empty() ? none : 0;
+  count = seq.size();
+  order = target;
+  return true;
+}
+
 template<class T>
 using BinaryTree = NaryTree<T, 2>;
 
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "../util/epoch.h"
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <random>
+#include <utility>
+
+// Lock-free skip list safe for concurrent insert, erase and find
+// erased nodes are first marked (logical deletion) then unlinked by any thread passing them
+// unlinked nodes are freed through epoch based reclamation (util/epoch.h)
+
+// T: element type (must implement comparisons and be copyable, must have a default constructor)
+// L: max levels (L >= 1)
+template<class T = int, size_t L = 12>
+class ConcurrentSkipList {
+  static_assert(L >= 1);
+
+  // next pointers store a mark in their lowest bit
+  // a marked next[i] means the node is deleted from layer i
+  struct Node {
+    Node(size_t layers, T &&value) : value(std::move(value)), layers(layers) {}
+    Node(size_t layers) : layers(layers) {}
+
+    T value;
+    uint32_t layers;
+    std::atomic<uint32_t> owners = 2; // inserter and eraser, last one to finish retires node
+    std::atomic<uintptr_t> next[1]; // extends past end of struct (one per layer)
+  };
+
+  static Node *ptr(uintptr_t link) { return reinterpret_cast<Node *>(link & ~(uintptr_t)1); }
+  static bool marked(uintptr_t link) { return link & 1; }
+  static uintptr_t to_link(Node *node) { return reinterpret_cast<uintptr_t>(node); }
+
+public:
+  // forward iterator over layer 0 that skips erased nodes
+  // keeps the epoch pinned until it reaches end, so nodes stay valid under concurrent erases
+  // (must be destroyed on the thread that created it)
+  struct Iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T *;
+    using reference = T &;
+
+    Iterator(Node *ptr = nullptr) : ptr(ptr) {}
+    Iterator(const Iterator &other) : ptr(other.ptr) {
+      if (ptr != nullptr) EpochManager::instance().pin();
+    }
+    Iterator &operator=(const Iterator &other) {
+      if (other.ptr != nullptr) EpochManager::instance().pin();
+      if (ptr != nullptr) EpochManager::instance().unpin();
+      ptr = other.ptr;
+      return *this;
+    }
+    ~Iterator() {
+      if (ptr != nullptr) EpochManager::instance().unpin();
+    }
+
+    reference operator*() { return ptr->value; }
+    pointer operator->() { return &ptr->value; }
+    bool operator==(const Iterator &other) const { return ptr == other.ptr; }
+    bool operator!=(const Iterator &other) const { return ptr != other.ptr; }
+
+    Iterator &operator++() {
+      ptr = first_live(ptr->next[0].load());
+      if (ptr == nullptr) EpochManager::instance().unpin();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator res = *this;
+      ++*this;
+      return res;
+    }
+  private:
+    Node *ptr;
+  };
+
+  // p: probability that element in layer k is in layer k+1 (0 <= P < 1)
+  ConcurrentSkipList(double p = 0.5) : p(p) {
+    head = create_node(L);
+    for (size_t i = 0; i < L; ++i)
+      head->next[i].store(0);
+  }
+  ConcurrentSkipList(const ConcurrentSkipList &) = delete;
+  ConcurrentSkipList &operator=(const ConcurrentSkipList &) = delete;
+  ~ConcurrentSkipList() {
+    clear();
+    free_node(head);
+  }
+
+  Iterator begin() {
+    EpochManager::instance().pin();
+    Node *node = first_live(head->next[0].load());
+    if (node == nullptr) EpochManager::instance().unpin();
+    return Iterator(node);
+  }
+  Iterator end() { return Iterator(nullptr); }
+
+  // exact when no operation is in progress
+  size_t size() const { return std::max<std::ptrdiff_t>(n.load(), 0); }
+
+  // gets first instance of value
+  // returns nullptr if none exist
+  // the pointer is only valid until that instance is erased
+  T *find(const T &value) const {
+    EpochGuard guard;
+    Node *node = search_live(value);
+    return node == nullptr || node->value != value ? nullptr : &node->value;
+  }
+
+  // returns true if value is in skiplist
+  bool contains(const T &value) const {
+    EpochGuard guard;
+    Node *node = search_live(value);
+    return node != nullptr && node->value == value;
+  }
+
+  // insert one instance of this value
+  void insert(T value) {
+    insert_node(create_node(sample_layers(), std::move(value)), false);
+  }
+
+  // insert value if not in skiplist
+  // return true if insertion performed
+  bool insert_if_none(T value) {
+    return insert_node(create_node(sample_layers(), std::move(value)), true);
+  }
+
+  // remove one instance of this value
+  // return true if removal performed
+  bool erase(const T &value) {
+    EpochGuard guard;
+    Node *preds[L], *succs[L];
+    while (true) {
+      search(value, preds, succs);
+      Node *node = succs[0];
+      if (node == nullptr || node->value != value)
+        return false;
+
+      // mark upper layers top down so inserter stops building tower
+      for (size_t i = node->layers; i-- > 1;) {
+        uintptr_t succ = node->next[i].load();
+        while (!marked(succ) && !node->next[i].compare_exchange_weak(succ, succ | 1));
+      }
+
+      // whoever marks layer 0 owns the removal
+      uintptr_t succ = node->next[0].load();
+      while (!marked(succ)) {
+        if (node->next[0].compare_exchange_weak(succ, succ | 1)) {
+          --n;
+          unlink(node);
+          release(node);
+          return true;
+        }
+      }
+      // lost race to another eraser, look for another instance
+    }
+  }
+
+  // clears list
+  // not thread safe (no other operation may run concurrently)
+  void clear() {
+    Node *curr = ptr(head->next[0].load());
+    while (curr != nullptr) {
+      Node *next = ptr(curr->next[0].load());
+      free_node(curr);
+      curr = next;
+    }
+    for (size_t i = 0; i < L; ++i)
+      head->next[i].store(0);
+    n = 0;
+  }
+private:
+  Node *head;
+  std::atomic<std::ptrdiff_t> n = 0;
+  double p;
+
+  // nodes use the global allocator as they are freed by whichever thread reclaims them
+  static Node *create_node(size_t layers) {
+    void *mem = ::operator new(node_bytes(layers), std::align_val_t(alignof(Node)));
+    return new (mem) Node(layers);
+  }
+  static Node *create_node(size_t layers, T &&value) {
+    void *mem = ::operator new(node_bytes(layers), std::align_val_t(alignof(Node)));
+    return new (mem) Node(layers, std::move(value));
+  }
+  static void free_node(void *mem) {
+    static_cast<Node *>(mem)->~Node();
+    ::operator delete(mem, std::align_val_t(alignof(Node)));
+  }
+  static constexpr size_t node_bytes(size_t layers) {
+    return sizeof(Node) + (layers - 1) * sizeof(std::atomic<uintptr_t>);
+  }
+
+  // skips nodes erased from layer 0
+  static Node *first_live(uintptr_t link) {
+    Node *node = ptr(link);
+    while (node != nullptr && marked(node->next[0].load()))
+      node = ptr(node->next[0].load());
+    return node;
+  }
+
+  bool insert_node(Node *node, bool unique) {
+    EpochGuard guard;
+    Node *preds[L], *succs[L];
+    while (true) {
+      search(node->value, preds, succs);
+      if (unique && succs[0] != nullptr && succs[0]->value == node->value) {
+        free_node(node);
+        return false;
+      }
+      for (size_t i = 0; i < node->layers; ++i)
+        node->next[i].store(to_link(succs[i]), std::memory_order_relaxed);
+
+      // node is in the list once linked into layer 0
+      uintptr_t expected = to_link(succs[0]);
+      if (preds[0]->next[0].compare_exchange_strong(expected, to_link(node)))
+        break;
+    }
+    ++n;
+
+    // build rest of tower, giving up once node is being erased
+    for (size_t i = 1; i < node->layers; ++i) {
+      while (true) {
+        uintptr_t succ = node->next[i].load();
+        if (marked(succ))
+          goto finished;
+        if (succ != to_link(succs[i]) && !node->next[i].compare_exchange_strong(succ, to_link(succs[i])))
+          continue;
+        uintptr_t expected = to_link(succs[i]);
+        if (preds[i]->next[i].compare_exchange_strong(expected, to_link(node)))
+          break;
+        search(node->value, preds, succs);
+      }
+    }
+  finished:
+    // node may have been linked into a layer after its eraser unlinked it
+    if (marked(node->next[0].load()))
+      unlink(node);
+    release(node);
+    return true;
+  }
+
+  // drops one owner of node, retiring it if it was the last
+  static void release(Node *node) {
+    if (node->owners.fetch_sub(1) == 1)
+      EpochManager::instance().retire(node, free_node);
+  }
+
+  // finds last node with value less than target and first node after it in each layer
+  // unlinks marked nodes it passes (restarting if a neighbour changed)
+  void search(const T &target, Node **preds, Node **succs) const {
+  retry:
+    Node *pred = head;
+    for (size_t layer = L; layer-- > 0;) {
+      Node *curr = ptr(pred->next[layer].load());
+      while (curr != nullptr) {
+        uintptr_t succ = curr->next[layer].load();
+        if (marked(succ)) {
+          uintptr_t expected = to_link(curr);
+          if (!pred->next[layer].compare_exchange_strong(expected, succ & ~(uintptr_t)1))
+            goto retry;
+          curr = ptr(succ);
+          continue;
+        }
+        if (!(curr->value < target))
+          break;
+        pred = curr;
+        curr = ptr(succ);
+      }
+      preds[layer] = pred;
+      succs[layer] = curr;
+    }
+  }
+
+  // read-only version of search that skips marked nodes instead of unlinking them
+  // returns first unmarked node with value at least target
+  Node *search_live(const T &target) const {
+    Node *pred = head;
+    Node *curr = nullptr;
+    for (size_t layer = L; layer-- > 0;) {
+      curr = ptr(pred->next[layer].load());
+      while (curr != nullptr) {
+        uintptr_t succ = curr->next[layer].load();
+        if (!marked(succ)) {
+          if (!(curr->value < target))
+            break;
+          pred = curr;
+        }
+        curr = ptr(succ);
+      }
+    }
+    return curr;
+  }
+
+  // unlinks marked node from every layer it is still linked in
+  // equal values may be ordered differently between layers, so the whole run of them is scanned
+  void unlink(Node *node) {
+    Node *preds[L], *succs[L];
+  retry:
+    search(node->value, preds, succs);
+    for (size_t layer = 0; layer < node->layers; ++layer) {
+      Node *pred = preds[layer];
+      Node *curr = succs[layer];
+      while (curr != nullptr && !(node->value < curr->value)) {
+        uintptr_t succ = curr->next[layer].load();
+        if (marked(succ)) {
+          uintptr_t expected = to_link(curr);
+          if (!pred->next[layer].compare_exchange_strong(expected, succ & ~(uintptr_t)1))
+            goto retry;
+        } else {
+          pred = curr;
+        }
+        curr = ptr(succ);
+      }
+    }
+  }
+
+  // each thread samples from its own engine
+  size_t sample_layers() const {
+    thread_local std::default_random_engine rng(std::random_device{}());
+    return std::min(std::geometric_distribution<size_t>(1.0 - p)(rng) + 1, L);
+  }
+};
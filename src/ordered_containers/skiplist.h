@@ -1,9 +1,21 @@
 #pragma once
 
 #include "../util/iterator.h"
+#include "../util/arena.h"
+#include "../util/mapped_file.h"
 #include <stddef.h>
+#include <cstdint>
 #include <random>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <stdexcept>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 // T: element type (must implement comparisons and be copyable, must have a default constructor)
 // L: max levels (L >= 1)
@@ -11,124 +23,757 @@ template<class T = int, size_t L = 12>
 class SkipList {
   static_assert(L >= 1);
 
+  // nodes are allocated with room for exactly as many next pointers as layers,
+  // followed by the width of each of those links
+  // (next is declared with 1 entry but extends past the end of the struct)
   struct Node {
-    Node(size_t layers, T value) : layers(layers), value(value) {}
+    Node(size_t layers, T &&value) : value(std::move(value)), layers(layers) {}
     Node(size_t layers) : layers(layers) {}
-    Node() {}
 
     T &operator*() { return value; }
     T *operator->() { return &value; }
 
+    // width[i]: number of layer 0 steps to next[i] (to one past the last node if null)
+    size_t *width() { return reinterpret_cast<size_t *>(next + layers); }
+
     T value;
-    size_t layers;
-    Node *next[L] = {};
+    uint32_t layers;
+    Node *next[1];
+  };
+
+  // overlays the memory of a freed node
+  struct FreeNode {
+    FreeNode *next;
   };
 
   using Iterator = LinkedListIterator<T, Node>;
 public:
-  // p: probability that element in layer k is in layer k+1 (0 <= P <= 1)
-  SkipList(double p = 0.5) : head(0), tail(L), gd(p) {
-    for (size_t i = 0; i < L; ++i)
-      head.next[i] = &tail;
+  // p: probability that element in layer k is in layer k+1 (0 <= P < 1)
+  SkipList(double p = 0.5) : gd(1.0 - p) {
+    init_head();
   }
-  ~SkipList() {
+  // constructs list from a range (O(n) if already sorted)
+  template<class It>
+  SkipList(It first, It last, double p = 0.5, bool balanced = false) : SkipList(p) {
+    assign(first, last, balanced);
+  }
+  SkipList(const SkipList &) = delete;
+  SkipList &operator=(const SkipList &) = delete;
+  // other is left empty
+  SkipList(SkipList &&other) : SkipList(1.0 - other.gd.p()) {
+    swap(other);
+  }
+  SkipList &operator=(SkipList &&other) {
     clear();
+    swap(other);
+    return *this;
+  }
+  ~SkipList() {
+    destroy_values();
+  }
+
+  void swap(SkipList &other) {
+    swap_contents(other);
+    std::swap(rng, other.rng);
+    std::swap(gd, other.gd);
+    std::swap(use_finger, other.use_finger);
   }
 
-  Iterator begin() { return Iterator(head.next[0]); }
-  Iterator end() { return Iterator(&tail); }
+  Iterator begin() { return Iterator(head->next[0]); }
+  Iterator end() { return Iterator(nullptr); }
   size_t size() const { return n; }
 
   // gets first instance of value
   // returns nullptr if none exist
   T *find(const T &value) const {
     Node *node = search(value);
-    return node == tail ? nullptr : &node->val;
+    return node == nullptr || node->value != value ? nullptr : &node->value;
+  }
+
+  // first element not less than value
+  Iterator lower_bound(const T &value) { return Iterator(search(value)); }
+
+  // gets element at index (0-indexed in sorted order)
+  T &at(size_t index) {
+    if (index >= n)
+      throw std::out_of_range("SkipList::at");
+    Node *curr = head;
+    size_t pos = 0;
+    for (size_t layer = L; layer-- > 0;) {
+      while (curr->next[layer] != nullptr && pos + curr->width()[layer] <= index + 1) {
+        pos += curr->width()[layer];
+        curr = curr->next[layer];
+      }
+    }
+    return curr->value;
+  }
+
+  // number of elements less than value (index of first instance if present)
+  size_t rank(const T &value) const {
+    size_t ranks[L];
+    search_prev(value, nullptr, ranks);
+    return ranks[0];
+  }
+
+  // number of elements in [lo, hi)
+  size_t count(const T &lo, const T &hi) const {
+    return hi < lo ? 0 : rank(hi) - rank(lo);
   }
-  T *find(T value) const { return find(value); }
-  T *find(T &&value) const { return find(value); }
 
   // insert one instance of this value
   void insert(T value) {
-    Node *prev = search_prev(value);
-    Node *node = new Node(sample_layers(), value);
-    for (size_t i = 0; i < node->layers; ++i) {
-      node->next[i] = prev->next[i];
-      prev->next[i] = node;
-    }
-    ++n;
+    Node *update[L];
+    size_t ranks[L];
+    search_prev(value, update, ranks);
+    link(create_node(sample_layers(), std::move(value)), update, ranks);
+  }
+
+  // insert one instance of this value, where hint is the position it would be inserted before
+  // skips the search if hint is the node right after the previous search path or the one after that,
+  // i.e. the previously inserted node or its successor, so insert(end(), v) appends in O(1) (finger mode only)
+  // returns iterator to inserted value
+  Iterator insert(Iterator hint, T value) {
+    Node *update[L];
+    size_t ranks[L];
+    Node *prev = finger[0], *next = prev->next[0];
+    if (use_finger && hint == Iterator(next) && (prev == head || prev->value < value)
+        && (hint == end() || !(*hint < value))) {
+      // previous path brackets value, so it is also the path for value
+      std::copy(finger, finger + L, update);
+      std::copy(finger_ranks, finger_ranks + L, ranks);
+    } else if (use_finger && next != nullptr && hint == Iterator(next->next[0]) && !(value < next->value)
+        && (hint == end() || !(*hint < value))) {
+      // value goes right after next, which replaces the previous path in the layers it reaches
+      std::copy(finger, finger + L, update);
+      std::copy(finger_ranks, finger_ranks + L, ranks);
+      for (size_t i = 0; i < next->layers; ++i) {
+        update[i] = next;
+        ranks[i] = finger_ranks[0] + 1;
+      }
+      std::copy(update, update + L, finger);
+      std::copy(ranks, ranks + L, finger_ranks);
+    } else
+      search_prev(value, update, ranks);
+    Node *node = create_node(sample_layers(), std::move(value));
+    link(node, update, ranks);
+    return Iterator(node);
   }
 
   // insert value if not in skiplist
   // return true if insertion performed
   bool insert_if_none(T value) {
-    Node *prev = search_prev(value);
-    if (prev->next[0] != &tail && prev->next[0]->value == value)
+    Node *update[L];
+    size_t ranks[L];
+    Node *prev = search_prev(value, update, ranks);
+    if (prev->next[0] != nullptr && prev->next[0]->value == value)
       return false;
 
-    Node *node = new Node(sample_layers());
-    for (size_t i = 0; i < node->layers; ++i) {
-      node->next[i] = prev->next[i];
-      prev->next[i] = node;
-    }
+    link(create_node(sample_layers(), std::move(value)), update, ranks);
     return true;
   }
 
+  // replaces contents with the values in range
+  // sorted input is appended in O(n), otherwise it is sorted first
+  // balanced: use deterministic tower heights (every 1/p-th node is promoted) instead of sampling
+  template<class It>
+  void assign(It first, It last, bool balanced = false) {
+    clear();
+    if (!std::is_sorted(first, last)) {
+      std::vector<T> sorted(first, last);
+      std::sort(sorted.begin(), sorted.end());
+      append_sorted(sorted.begin(), sorted.end(), balanced);
+    } else
+      append_sorted(first, last, balanced);
+  }
+
+  // inserts all values in range with a single pass over the list
+  template<class It>
+  void insert_batch(It first, It last) {
+    std::vector<T> batch(first, last);
+    std::sort(batch.begin(), batch.end());
+
+    // batch is sorted, so predecessors of each value are at or after those of the previous one
+    Node *update[L];
+    size_t ranks[L];
+    for (size_t i = 0; i < L; ++i) {
+      update[i] = head;
+      ranks[i] = 0;
+    }
+    for (T &value : batch) {
+      search_prev_from(value, update, ranks);
+      link(create_node(sample_layers(), std::move(value)), update, ranks);
+    }
+    reset_finger();
+  }
+
   // remove one instance of this value
   // return true if removal performed
-  bool erase(T value) {
-    Node *prev = search_prev(value);
-    Node *node = prev->next[0];
-    if (node == &tail || node->value != value)
+  bool erase(const T &value) {
+    Node *update[L];
+    Node *node = search_prev(value, update)->next[0];
+    if (node == nullptr || node->value != value)
       return false;
-    
-    for (size_t i = 0; i < node->layers; ++i)
-      prev->next[i] = node->next[i];
-    delete node;
-    --n;
+
+    unlink(node, update);
     return true;
   }
 
-  // clears list
-  void clear() {
-    Node *curr = head.next[0];
-    while (curr != &tail) {
-      Node *next = curr->next[0];
-      delete curr;
-      curr = next;
+  // remove element at index (0-indexed in sorted order)
+  // return true if removal performed
+  bool erase_at(size_t index) {
+    if (index >= n)
+      return false;
+
+    Node *update[L];
+    Node *curr = head;
+    size_t pos = 0;
+    for (size_t layer = L; layer-- > 0;) {
+      while (curr->next[layer] != nullptr && pos + curr->width()[layer] <= index) {
+        pos += curr->width()[layer];
+        curr = curr->next[layer];
+      }
+      update[layer] = curr;
     }
-    for (size_t i = 0; i < L; ++i)
-      head.next[i] = &tail;
+    unlink(curr->next[0], update);
+    reset_finger();
+    return true;
+  }
+
+  // clears list (releases all node memory at once)
+  void clear() {
+    destroy_values();
+    borrowed.clear();
+    if (arena.use_count() == 1)
+      arena->release();
+    else
+      arena = std::make_shared<Arena>(); // other lists still hold nodes from it
+    init_head();
     n = 0;
   }
+
+  // moves all elements at least key into a new list in O(log n + L)
+  // (the lists then share node memory, but can be used from different threads)
+  SkipList split(const T &key) {
+    Node *update[L];
+    size_t ranks[L];
+    search_prev(key, update, ranks);
+
+    SkipList res(1.0 - gd.p());
+    size_t split_pos = ranks[0];
+    for (size_t i = 0; i < L; ++i) {
+      res.head->next[i] = update[i]->next[i];
+      res.head->width()[i] = ranks[i] + update[i]->width()[i] - split_pos;
+      update[i]->next[i] = nullptr;
+      update[i]->width()[i] = split_pos + 1 - ranks[i];
+    }
+    res.n = n - split_pos;
+    n = split_pos;
+    res.use_finger = use_finger;
+
+    res.borrow(arena);
+    for (std::shared_ptr<Arena> &other : borrowed)
+      res.borrow(other);
+    reset_finger();
+    return res;
+  }
+
+  // moves all elements of other into this list in O(log n + L)
+  // every element of other must be not less than every element of this list, or the reverse
+  // return true if joined (false if the ranges overlap, in which case neither list changes)
+  bool join(SkipList &other) {
+    if (other.n == 0)
+      return true;
+    Tails tails;
+    find_tails(tails);
+    if (n > 0 && other.head->next[0]->value < tails.nodes[0]->value) {
+      // other must go in front
+      Tails other_tails;
+      other.find_tails(other_tails);
+      if (head->next[0]->value < other_tails.nodes[0]->value)
+        return false;
+      swap_contents(other);
+      std::swap(tails, other_tails);
+    }
+
+    for (size_t i = 0; i < L; ++i) {
+      tails.nodes[i]->next[i] = other.head->next[i];
+      tails.nodes[i]->width()[i] = n - tails.pos[i] + other.head->width()[i];
+      other.head->next[i] = nullptr;
+      other.head->width()[i] = 1;
+    }
+    n += other.n;
+    other.n = 0;
+
+    borrow(other.arena);
+    for (std::shared_ptr<Arena> &arena : other.borrowed)
+      borrow(arena);
+    reset_finger();
+    other.reset_finger();
+    return true;
+  }
+
+  // finger mode: searches start from the previous search path instead of head
+  // a search for a value d elements away from the previous one costs O(log d)
+  // (suited to sequential or clustered access, e.g. increasing timestamps)
+  void set_finger(bool enabled) {
+    use_finger = enabled;
+    reset_finger();
+  }
+
+  // Snapshots (binary files holding the sorted values and their tower heights)
+  // only available for trivially copyable T
+  // layout: SnapshotHeader, then chunks of { uint64 count, T values[count], uint8 heights[count] }
+  // with each chunk padded to a multiple of 8 bytes
+
+  struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t value_size;
+    uint64_t count; // snapshot_incomplete until the writer finishes
+    uint64_t reserved;
+  };
+  static constexpr char snapshot_magic[8] = "SKIPLST";
+  static constexpr uint32_t snapshot_version = 1;
+  static constexpr uint64_t snapshot_incomplete = UINT64_MAX;
+
+  // writes a snapshot a few values at a time, so no single step pauses for the whole list
+  // the list may be modified between steps: the snapshot then holds every value that was
+  // present when the writer passed its position
+  class SnapshotWriter {
+  public:
+    SnapshotWriter(SkipList &list, const char *path) : list(list), file(std::fopen(path, "wb")) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      static_assert(L <= UINT8_MAX);
+      good = file != nullptr && write_header(snapshot_incomplete);
+    }
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+    ~SnapshotWriter() {
+      if (file != nullptr)
+        std::fclose(file);
+    }
+
+    // writes up to max_count more values (0 writes all remaining ones, still buffered chunk_size at a time)
+    // returns true while values remain (the file is complete once this returns false)
+    bool step(size_t max_count) {
+      if (max_count == 0) {
+        while (step(chunk_size));
+        return false;
+      }
+      if (done || !good)
+        return false;
+
+      // resume after the last value written (skipping the duplicates of it already written)
+      Node *node = list.head->next[0];
+      if (count > 0) {
+        node = list.search_prev(last)->next[0];
+        for (size_t i = 0; i < dups && node != nullptr && node->value == last; ++i)
+          node = node->next[0];
+      }
+
+      values.clear();
+      heights.clear();
+      for (; node != nullptr && values.size() < max_count; node = node->next[0]) {
+        if (count + values.size() > 0 && node->value == last)
+          ++dups;
+        else {
+          last = node->value;
+          dups = 1;
+        }
+        values.push_back(node->value);
+        heights.push_back(node->layers);
+      }
+      if (!values.empty())
+        good = write_chunk();
+      count += values.size();
+
+      if (node == nullptr) {
+        done = true;
+        good = good && std::fseek(file, 0, SEEK_SET) == 0 && write_header(count);
+        good = std::fclose(file) == 0 && good;
+        file = nullptr;
+      }
+      return !done && good;
+    }
+
+    // false if any write failed
+    bool ok() const { return good; }
+    bool finished() const { return done; }
+  private:
+    static constexpr size_t chunk_size = 4096;
+
+    SkipList &list;
+    std::FILE *file;
+    bool good;
+    bool done = false;
+    uint64_t count = 0; // values written so far
+    T last; // last value written
+    size_t dups = 0; // instances of last written
+    std::vector<T> values;
+    std::vector<uint8_t> heights;
+
+    bool write_header(uint64_t total) {
+      SnapshotHeader header = {};
+      std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+      header.version = snapshot_version;
+      header.value_size = sizeof(T);
+      header.count = total;
+      return std::fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    bool write_chunk() {
+      uint64_t chunk_count = values.size();
+      static const char padding[8] = {};
+      size_t pad = chunk_bytes(chunk_count) - sizeof(uint64_t) - chunk_count * (sizeof(T) + 1);
+      return std::fwrite(&chunk_count, sizeof(chunk_count), 1, file) == 1
+        && std::fwrite(values.data(), sizeof(T), chunk_count, file) == chunk_count
+        && std::fwrite(heights.data(), 1, chunk_count, file) == chunk_count
+        && std::fwrite(padding, 1, pad, file) == pad;
+    }
+  };
+
+  // starts a streaming snapshot (see SnapshotWriter)
+  SnapshotWriter snapshot(const char *path) {
+    return SnapshotWriter(*this, path);
+  }
+
+  // writes the whole list to a snapshot file
+  // return true if successful
+  bool save(const char *path) {
+    SnapshotWriter writer(*this, path);
+    writer.step(0);
+    return writer.ok();
+  }
+
+  // replaces contents with a snapshot file
+  // the file is memory mapped and values are appended with their saved heights,
+  // so loading is a single sequential pass with no searches or sampling
+  // return true if successful (list is left unchanged if the file is malformed,
+  // and left empty if its values turn out not to be sorted)
+  bool load(const char *path) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    MappedFile file(path);
+    if (!file.is_open() || file.size() < sizeof(SnapshotHeader))
+      return false;
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0
+        || header.version != snapshot_version || header.value_size != sizeof(T)
+        || header.count == snapshot_incomplete)
+      return false;
+
+    // check chunk bounds before touching the list
+    const std::byte *first = file.data() + sizeof(SnapshotHeader);
+    const std::byte *last = file.data() + file.size();
+    const std::byte *pos = first;
+    uint64_t total = 0;
+    while (total < header.count) {
+      uint64_t chunk_count;
+      if (last - pos < (ptrdiff_t)sizeof(chunk_count))
+        return false;
+      std::memcpy(&chunk_count, pos, sizeof(chunk_count));
+      if (chunk_count == 0 || chunk_count > (uint64_t)(last - pos) / (sizeof(T) + 1)
+          || chunk_bytes(chunk_count) > (uint64_t)(last - pos))
+        return false;
+      total += chunk_count;
+      pos += chunk_bytes(chunk_count);
+    }
+    if (total != header.count)
+      return false;
+
+    clear();
+    Tails tails;
+    begin_append(tails);
+    for (const std::byte *chunk = first; chunk != pos;) {
+      uint64_t chunk_count;
+      std::memcpy(&chunk_count, chunk, sizeof(chunk_count));
+      const std::byte *values = chunk + sizeof(chunk_count);
+      const std::byte *heights = values + chunk_count * sizeof(T);
+      for (size_t i = 0; i < chunk_count; ++i) {
+        T value;
+        std::memcpy(&value, values + i * sizeof(T), sizeof(T));
+        if (n > 0 && value < tails.nodes[0]->value) {
+          end_append(tails);
+          clear();
+          return false;
+        }
+        append(tails, std::move(value), std::clamp<size_t>((uint8_t)heights[i], 1, L));
+      }
+      chunk += chunk_bytes(chunk_count);
+    }
+    end_append(tails);
+    return true;
+  }
 private:
+  // bytes used by a snapshot chunk holding count values
+  static constexpr uint64_t chunk_bytes(uint64_t count) {
+    return (sizeof(uint64_t) + count * (sizeof(T) + 1) + 7) / 8 * 8;
+  }
+
   size_t n = 0;
 
-  Node head;
-  Node tail;
+  Node *head;
+  std::shared_ptr<Arena> arena = std::make_shared<Arena>(); // nodes are allocated from here
+  std::vector<std::shared_ptr<Arena>> borrowed; // arenas of nodes received through split and join
+  FreeNode *free_nodes[L] = {}; // free lists of released nodes (index = layers - 1)
 
   std::default_random_engine rng;
   std::geometric_distribution<size_t> gd;
 
+  // path of the previous search in finger mode (last node less than its target in each layer)
+  bool use_finger = false;
+  mutable Node *finger[L];
+  mutable size_t finger_ranks[L];
+
+  // bytes occupied by a node with the given number of layers
+  static constexpr size_t node_bytes(size_t layers) {
+    return sizeof(Node) + (layers - 1) * sizeof(Node *) + layers * sizeof(size_t);
+  }
+
+  // allocates node from the free list of its height (or the arena if empty)
+  template<class... Args>
+  Node *create_node(size_t layers, Args&&... args) {
+    void *mem = free_nodes[layers - 1];
+    if (mem != nullptr)
+      free_nodes[layers - 1] = free_nodes[layers - 1]->next;
+    else
+      mem = arena->allocate(node_bytes(layers), alignof(Node));
+    return new (mem) Node(layers, std::forward<Args>(args)...);
+  }
+
+  // returns node memory to the free list of its height
+  void destroy_node(Node *node) {
+    size_t layers = node->layers;
+    node->~Node();
+    free_nodes[layers - 1] = new (node) FreeNode{free_nodes[layers - 1]};
+  }
+
+  // runs destructors of all nodes without freeing their memory
+  void destroy_values() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      Node *curr = head;
+      while (curr != nullptr) {
+        Node *next = curr->next[0];
+        curr->~Node();
+        curr = next;
+      }
+    }
+  }
+
+  void init_head() {
+    for (size_t i = 0; i < L; ++i)
+      free_nodes[i] = nullptr;
+    head = create_node(L);
+    for (size_t i = 0; i < L; ++i) {
+      head->next[i] = nullptr;
+      head->width()[i] = 1;
+    }
+    reset_finger();
+  }
+
+  void reset_finger() {
+    for (size_t i = 0; i < L; ++i) {
+      finger[i] = head;
+      finger_ranks[i] = 0;
+    }
+  }
+
+  // splices node in after the predecessors in update
+  // ranks[i]: position of update[i] (head is position 0)
+  void link(Node *node, Node **update, const size_t *ranks) {
+    size_t pos = ranks[0] + 1;
+    for (size_t i = 0; i < node->layers; ++i) {
+      node->next[i] = update[i]->next[i];
+      node->width()[i] = ranks[i] + update[i]->width()[i] + 1 - pos;
+      update[i]->next[i] = node;
+      update[i]->width()[i] = pos - ranks[i];
+    }
+    for (size_t i = node->layers; i < L; ++i)
+      ++update[i]->width()[i];
+    ++n;
+  }
+
+  // removes node given the predecessors in each layer
+  void unlink(Node *node, Node **update) {
+    for (size_t i = 0; i < node->layers; ++i) {
+      update[i]->next[i] = node->next[i];
+      update[i]->width()[i] += node->width()[i] - 1;
+    }
+    for (size_t i = node->layers; i < L; ++i)
+      --update[i]->width()[i];
+    destroy_node(node);
+    --n;
+  }
+
+  // last node and its position in each layer, used to build a list by appending
+  struct Tails {
+    Node *nodes[L];
+    size_t pos[L];
+  };
+
+  // swaps elements (and the memory holding them) but not settings
+  void swap_contents(SkipList &other) {
+    std::swap(n, other.n);
+    std::swap(head, other.head);
+    std::swap(arena, other.arena);
+    std::swap(borrowed, other.borrowed);
+    std::swap(free_nodes, other.free_nodes);
+    reset_finger();
+    other.reset_finger();
+  }
+
+  // finds last node in each layer
+  void find_tails(Tails &tails) const {
+    Node *curr = head;
+    size_t pos = 0;
+    for (size_t layer = L; layer-- > 0;) {
+      while (curr->next[layer] != nullptr) {
+        pos += curr->width()[layer];
+        curr = curr->next[layer];
+      }
+      tails.nodes[layer] = curr;
+      tails.pos[layer] = pos;
+    }
+  }
+
+  // keeps an arena alive while this list may hold nodes from it
+  void borrow(const std::shared_ptr<Arena> &other) {
+    if (other != arena && std::find(borrowed.begin(), borrowed.end(), other) == borrowed.end())
+      borrowed.push_back(other);
+  }
+
+  // starts appending to an empty list
+  void begin_append(Tails &tails) {
+    for (size_t i = 0; i < L; ++i) {
+      tails.nodes[i] = head;
+      tails.pos[i] = 0;
+    }
+  }
+
+  // appends value (must not be less than the last value) with the given number of layers
+  void append(Tails &tails, T &&value, size_t layers) {
+    size_t pos = n + 1;
+    Node *node = create_node(layers, std::move(value));
+    for (size_t i = 0; i < layers; ++i) {
+      tails.nodes[i]->next[i] = node;
+      tails.nodes[i]->width()[i] = pos - tails.pos[i];
+      tails.nodes[i] = node;
+      tails.pos[i] = pos;
+    }
+    ++n;
+  }
+
+  // terminates every layer once done appending
+  void end_append(Tails &tails) {
+    for (size_t i = 0; i < L; ++i) {
+      tails.nodes[i]->next[i] = nullptr;
+      tails.nodes[i]->width()[i] = n + 1 - tails.pos[i];
+    }
+  }
+
+  // fills empty list with sorted values
+  template<class It>
+  void append_sorted(It first, It last, bool balanced) {
+    Tails tails;
+    begin_append(tails);
+
+    // nodes promoted to the next layer every base nodes when balanced
+    double q = 1.0 - gd.p();
+    size_t base = q > 0 ? std::max<size_t>(2, std::lround(1.0 / q)) : 0;
+    for (; first != last; ++first) {
+      size_t layers = 1;
+      if (!balanced)
+        layers = sample_layers();
+      else if (base != 0)
+        for (size_t k = n + 1; layers < L && k % base == 0; k /= base)
+          ++layers;
+      append(tails, T(*first), layers);
+    }
+    end_append(tails);
+  }
+
   // finds last node with value less than target
-  Node *search_prev(const T &target) {
-    size_t layer = L - 1;
-    Node *curr = &head;
-    while (true) {
-      if (curr->next[layer] == &tail || curr->next[layer]->value >= target) {
-        if (layer-- == 0) break;
-      } else
+  // if update is given, stores the last such node of each layer in it
+  // if ranks is given, stores the position of each of those nodes in it
+  Node *search_prev(const T &target, Node **update = nullptr, size_t *ranks = nullptr) const {
+    if (use_finger)
+      return search_prev_finger(target, update, ranks);
+
+    Node *curr = head;
+    size_t pos = 0;
+    for (size_t layer = L; layer-- > 0;) {
+      while (curr->next[layer] != nullptr && curr->next[layer]->value < target) {
+        pos += curr->width()[layer];
         curr = curr->next[layer];
+      }
+      if (update != nullptr)
+        update[layer] = curr;
+      if (ranks != nullptr)
+        ranks[layer] = pos;
     }
     return curr;
-  };
+  }
+
+  // search_prev starting from the previous search path
+  // climbs the path until it brackets target, then descends as usual
+  // (insert and erase keep the path valid for its target, other modifications reset it)
+  Node *search_prev_finger(const T &target, Node **update, size_t *ranks) const {
+    size_t layer = 0;
+    while (layer + 1 < L && ((finger[layer] != head && !(finger[layer]->value < target))
+        || (finger[layer + 1]->next[layer + 1] != nullptr && finger[layer + 1]->next[layer + 1]->value < target)))
+      ++layer;
+
+    Node *curr = finger[layer];
+    size_t pos = finger_ranks[layer];
+    if (curr != head && !(curr->value < target)) {
+      // target is before the whole path
+      curr = head;
+      pos = 0;
+    }
+    for (size_t i = layer + 1; i-- > 0;) {
+      if (finger_ranks[i] > pos && finger[i]->value < target) {
+        curr = finger[i];
+        pos = finger_ranks[i];
+      }
+      while (curr->next[i] != nullptr && curr->next[i]->value < target) {
+        pos += curr->width()[i];
+        curr = curr->next[i];
+      }
+      finger[i] = curr;
+      finger_ranks[i] = pos;
+    }
+    if (update != nullptr)
+      std::copy(finger, finger + L, update);
+    if (ranks != nullptr)
+      std::copy(finger_ranks, finger_ranks + L, ranks);
+    return finger[0];
+  }
+
+  // like search_prev but resumes from the predecessors already in update
+  // (every update[i] must have value less than target)
+  void search_prev_from(const T &target, Node **update, size_t *ranks) const {
+    Node *curr = update[L - 1];
+    size_t pos = ranks[L - 1];
+    for (size_t layer = L; layer-- > 0;) {
+      if (ranks[layer] > pos) {
+        curr = update[layer];
+        pos = ranks[layer];
+      }
+      while (curr->next[layer] != nullptr && curr->next[layer]->value < target) {
+        pos += curr->width()[layer];
+        curr = curr->next[layer];
+      }
+      update[layer] = curr;
+      ranks[layer] = pos;
+    }
+  }
 
   // finds first node with value at least target
-  Node *search(const T &target) {
-    return prev(target)->next[0];
+  Node *search(const T &target) const {
+    return search_prev(target)->next[0];
   }
 
   size_t sample_layers() {
-    return std::max(gd(rng) + 1, L);
-  };
-};
\ No newline at end of file
+    return std::min(gd(rng) + 1, L);
+  }
+};
@@ -0,0 +1,345 @@
+#pragma once
+
+#include "../util/iterator.h"
+#include "../util/arena.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Skip list keyed map with unique keys (std::map-like interface)
+// layer 0 is doubly linked and every layer is circular through head, which doubles as end()
+
+// K: key type
+// V: mapped type
+// Compare: strict weak ordering on keys (lookups accept other key types if it has is_transparent)
+// L: max levels (L >= 1)
+template<class K, class V, class Compare = std::less<>, size_t L = 12>
+class SkipListMap {
+  static_assert(L >= 1);
+public:
+  using value_type = std::pair<const K, V>;
+private:
+  // nodes are allocated with room for exactly as many next pointers as layers
+  // (next is declared with 1 entry but extends past the end of the struct)
+  // value is only constructed for non-head nodes
+  struct Node {
+    Node(size_t layers) : layers(layers) {}
+    ~Node() {}
+
+    value_type &operator*() { return value; }
+    value_type *operator->() { return &value; }
+
+    union {
+      value_type value;
+    };
+    Node *prev;
+    uint32_t layers;
+    Node *next[1];
+  };
+
+  // overlays the memory of a freed node
+  struct FreeNode {
+    FreeNode *next;
+  };
+
+public:
+  using Iterator = DoublyLinkedListIterator<value_type, Node>;
+  using ConstIterator = DoublyLinkedListIterator<const value_type, Node>;
+
+  // p: probability that element in layer k is in layer k+1 (0 <= P < 1)
+  SkipListMap(double p = 0.5, Compare comp = Compare()) : comp(comp), gd(1.0 - p) {
+    init_head();
+  }
+  SkipListMap(const SkipListMap &) = delete;
+  SkipListMap &operator=(const SkipListMap &) = delete;
+  ~SkipListMap() {
+    destroy_values();
+  }
+
+  Iterator begin() { return Iterator(head->next[0]); }
+  Iterator end() { return Iterator(head); }
+  ConstIterator begin() const { return ConstIterator(head->next[0]); }
+  ConstIterator end() const { return ConstIterator(head); }
+  std::reverse_iterator<Iterator> rbegin() { return std::reverse_iterator<Iterator>(end()); }
+  std::reverse_iterator<Iterator> rend() { return std::reverse_iterator<Iterator>(begin()); }
+  std::reverse_iterator<ConstIterator> rbegin() const { return std::reverse_iterator<ConstIterator>(end()); }
+  std::reverse_iterator<ConstIterator> rend() const { return std::reverse_iterator<ConstIterator>(begin()); }
+  size_t size() const { return n; }
+  bool empty() const { return n == 0; }
+
+  // returns end() if key not found
+  Iterator find(const K &key) { return Iterator(find_node(key)); }
+  ConstIterator find(const K &key) const { return ConstIterator(find_node(key)); }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  Iterator find(const Key &key) { return Iterator(find_node(key)); }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  ConstIterator find(const Key &key) const { return ConstIterator(find_node(key)); }
+
+  bool contains(const K &key) const { return find_node(key) != head; }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  bool contains(const Key &key) const { return find_node(key) != head; }
+
+  // first element with key at least key
+  Iterator lower_bound(const K &key) { return Iterator(search_prev(key)->next[0]); }
+  ConstIterator lower_bound(const K &key) const { return ConstIterator(search_prev(key)->next[0]); }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  Iterator lower_bound(const Key &key) { return Iterator(search_prev(key)->next[0]); }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  ConstIterator lower_bound(const Key &key) const { return ConstIterator(search_prev(key)->next[0]); }
+
+  // first element with key greater than key
+  Iterator upper_bound(const K &key) { return Iterator(search_prev_upper(key)->next[0]); }
+  ConstIterator upper_bound(const K &key) const { return ConstIterator(search_prev_upper(key)->next[0]); }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  Iterator upper_bound(const Key &key) { return Iterator(search_prev_upper(key)->next[0]); }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  ConstIterator upper_bound(const Key &key) const { return ConstIterator(search_prev_upper(key)->next[0]); }
+
+  std::pair<Iterator, Iterator> equal_range(const K &key) {
+    Iterator it = lower_bound(key);
+    if (it != end() && !comp(key, it->first))
+      return { it, std::next(it) };
+    return { it, it };
+  }
+  std::pair<ConstIterator, ConstIterator> equal_range(const K &key) const {
+    ConstIterator it = lower_bound(key);
+    if (it != end() && !comp(key, it->first))
+      return { it, std::next(it) };
+    return { it, it };
+  }
+  // a transparent key may be equivalent to several keys
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  std::pair<Iterator, Iterator> equal_range(const Key &key) { return { lower_bound(key), upper_bound(key) }; }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  std::pair<ConstIterator, ConstIterator> equal_range(const Key &key) const { return { lower_bound(key), upper_bound(key) }; }
+
+  // elements with keys in [lo, hi), usable in a range-based for loop
+  IteratorRange<Iterator> range(const K &lo, const K &hi) {
+    Iterator first = lower_bound(lo);
+    return { first, comp(lo, hi) ? lower_bound(hi) : first };
+  }
+  IteratorRange<ConstIterator> range(const K &lo, const K &hi) const {
+    ConstIterator first = lower_bound(lo);
+    return { first, comp(lo, hi) ? lower_bound(hi) : first };
+  }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  IteratorRange<Iterator> range(const Key &lo, const Key &hi) {
+    Iterator first = lower_bound(lo);
+    return { first, comp(lo, hi) ? lower_bound(hi) : first };
+  }
+  template<class Key, class C = Compare, class = typename C::is_transparent>
+  IteratorRange<ConstIterator> range(const Key &lo, const Key &hi) const {
+    ConstIterator first = lower_bound(lo);
+    return { first, comp(lo, hi) ? lower_bound(hi) : first };
+  }
+
+  V &at(const K &key) {
+    Node *node = find_node(key);
+    if (node == head)
+      throw std::out_of_range("SkipListMap::at");
+    return node->value.second;
+  }
+
+  // inserts default value if key not found
+  V &operator[](const K &key) {
+    return try_emplace(key).first->second;
+  }
+
+  // returns iterator to element with key and whether insertion performed
+  std::pair<Iterator, bool> insert(const value_type &value) {
+    return emplace(value);
+  }
+  std::pair<Iterator, bool> insert(value_type &&value) {
+    return emplace(std::move(value));
+  }
+
+  // constructs element in place (then discards it if key already present)
+  template<class... Args>
+  std::pair<Iterator, bool> emplace(Args&&... args) {
+    Node *node = create_node(sample_layers());
+    new (&node->value) value_type(std::forward<Args>(args)...);
+
+    Node *update[L];
+    Node *next = search_prev(node->value.first, update)->next[0];
+    if (next != head && !comp(node->value.first, next->value.first)) {
+      destroy_node(node);
+      return { Iterator(next), false };
+    }
+    link(node, update);
+    return { Iterator(node), true };
+  }
+
+  // constructs mapped value in place from args only if key not present
+  template<class... Args>
+  std::pair<Iterator, bool> try_emplace(const K &key, Args&&... args) {
+    return try_emplace_helper(key, std::forward<Args>(args)...);
+  }
+  template<class... Args>
+  std::pair<Iterator, bool> try_emplace(K &&key, Args&&... args) {
+    return try_emplace_helper(std::move(key), std::forward<Args>(args)...);
+  }
+
+  // inserts or overwrites mapped value
+  template<class M>
+  std::pair<Iterator, bool> insert_or_assign(const K &key, M &&obj) {
+    std::pair<Iterator, bool> res = try_emplace(key, std::forward<M>(obj));
+    if (!res.second)
+      res.first->second = std::forward<M>(obj);
+    return res;
+  }
+
+  // returns number of elements removed
+  size_t erase(const K &key) {
+    Node *update[L];
+    Node *node = search_prev(key, update)->next[0];
+    if (node == head || comp(key, node->value.first))
+      return 0;
+    unlink(node, update);
+    return 1;
+  }
+
+  // returns iterator to the element after pos
+  Iterator erase(Iterator pos) {
+    Node *node = pos.node();
+    Iterator next(node->next[0]);
+    Node *update[L];
+    search_prev(node->value.first, update);
+    unlink(node, update);
+    return next;
+  }
+
+  // clears map (releases all node memory at once)
+  void clear() {
+    destroy_values();
+    arena.release();
+    init_head();
+    n = 0;
+  }
+private:
+  size_t n = 0;
+
+  Node *head;
+  Arena arena;
+  FreeNode *free_nodes[L] = {}; // free lists of released nodes (index = layers - 1)
+  Compare comp;
+
+  std::default_random_engine rng;
+  std::geometric_distribution<size_t> gd;
+
+  template<class Key, class... Args>
+  std::pair<Iterator, bool> try_emplace_helper(Key &&key, Args&&... args) {
+    Node *update[L];
+    Node *next = search_prev(key, update)->next[0];
+    if (next != head && !comp(key, next->value.first))
+      return { Iterator(next), false };
+
+    Node *node = create_node(sample_layers());
+    new (&node->value) value_type(std::piecewise_construct,
+      std::forward_as_tuple(std::forward<Key>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    link(node, update);
+    return { Iterator(node), true };
+  }
+
+  // bytes occupied by a node with the given number of layers
+  static constexpr size_t node_bytes(size_t layers) {
+    return sizeof(Node) + (layers - 1) * sizeof(Node *);
+  }
+
+  // allocates node (without value) from the free list of its height or the arena
+  Node *create_node(size_t layers) {
+    void *mem = free_nodes[layers - 1];
+    if (mem != nullptr)
+      free_nodes[layers - 1] = free_nodes[layers - 1]->next;
+    else
+      mem = arena.allocate(node_bytes(layers), alignof(Node));
+    return new (mem) Node(layers);
+  }
+
+  // destroys value and returns node memory to the free list of its height
+  void destroy_node(Node *node) {
+    size_t layers = node->layers;
+    node->value.~value_type();
+    node->~Node();
+    free_nodes[layers - 1] = new (node) FreeNode{free_nodes[layers - 1]};
+  }
+
+  // runs destructors of all values without freeing their memory
+  void destroy_values() {
+    if constexpr (!std::is_trivially_destructible_v<value_type>) {
+      for (Node *curr = head->next[0]; curr != head; curr = curr->next[0])
+        curr->value.~value_type();
+    }
+  }
+
+  void init_head() {
+    for (size_t i = 0; i < L; ++i)
+      free_nodes[i] = nullptr;
+    head = create_node(L);
+    head->prev = head;
+    for (size_t i = 0; i < L; ++i)
+      head->next[i] = head;
+  }
+
+  // splices node in after the predecessors in update
+  void link(Node *node, Node **update) {
+    for (size_t i = 0; i < node->layers; ++i) {
+      node->next[i] = update[i]->next[i];
+      update[i]->next[i] = node;
+    }
+    node->prev = update[0];
+    node->next[0]->prev = node;
+    ++n;
+  }
+
+  // removes node given the predecessors in each layer
+  void unlink(Node *node, Node **update) {
+    for (size_t i = 0; i < node->layers; ++i)
+      update[i]->next[i] = node->next[i];
+    node->next[0]->prev = node->prev;
+    destroy_node(node);
+    --n;
+  }
+
+  // returns node with key or head if none
+  template<class Key>
+  Node *find_node(const Key &key) const {
+    Node *node = search_prev(key)->next[0];
+    return node == head || comp(key, node->value.first) ? head : node;
+  }
+
+  // finds last node with key less than target
+  // if update is given, stores the last such node of each layer in it
+  template<class Key>
+  Node *search_prev(const Key &target, Node **update = nullptr) const {
+    Node *curr = head;
+    for (size_t layer = L; layer-- > 0;) {
+      while (curr->next[layer] != head && comp(curr->next[layer]->value.first, target))
+        curr = curr->next[layer];
+      if (update != nullptr)
+        update[layer] = curr;
+    }
+    return curr;
+  }
+
+  // finds last node with key not greater than target
+  template<class Key>
+  Node *search_prev_upper(const Key &target) const {
+    Node *curr = head;
+    for (size_t layer = L; layer-- > 0;) {
+      while (curr->next[layer] != head && !comp(target, curr->next[layer]->value.first))
+        curr = curr->next[layer];
+    }
+    return curr;
+  }
+
+  size_t sample_layers() {
+    return std::min(gd(rng) + 1, L);
+  }
+};
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "../util/iterator.h"
+#include "../util/arena.h"
+#include <stddef.h>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <new>
+#include <random>
+#include <type_traits>
+#include <utility>
+
+// Unrolled skip list - skip list whose nodes each hold a sorted block of up to B elements
+// layers index blocks by their first element, so a lookup touches far fewer nodes than SkipList
+// and scans a contiguous block at the end (branchless counting loop for arithmetic types,
+// which compilers turn into SIMD compares)
+
+namespace unrolled_skiplist_detail {
+  // elements that fit a node in 2 cache lines (128 bytes) next to its count, layer count and first next pointer
+  template<class T>
+  constexpr size_t default_block() {
+    constexpr size_t header = 2 * sizeof(uint32_t) + sizeof(void *);
+    return std::max<size_t>(2, (128 - header) / sizeof(T));
+  }
+}
+
+// T: element type (must implement comparisons and be copyable, must have a default constructor)
+// L: max levels (L >= 1)
+// B: max elements per block (B >= 2), defaults to filling 2 cache lines with a single layer node
+template<class T = int, size_t L = 12, size_t B = unrolled_skiplist_detail::default_block<T>()>
+class UnrolledSkipList {
+  static_assert(L >= 1);
+  static_assert(B >= 2);
+
+  // blocks are allocated with room for exactly as many next pointers as layers
+  // (next is declared with 1 entry but extends past the end of the struct)
+  struct Node {
+    Node(size_t layers) : layers(layers) {
+      if constexpr (std::is_arithmetic_v<T>)
+        std::fill(keys, keys + B, padding());
+    }
+
+    T keys[B]; // sorted, only first count are used
+    uint32_t count = 0;
+    uint32_t layers;
+    Node *next[1];
+  };
+
+  // overlays the memory of a freed node
+  struct FreeNode {
+    FreeNode *next;
+  };
+
+  using Iterator = BlockListIterator<T, Node>;
+public:
+  // p: probability that block in layer k is in layer k+1 (0 <= P < 1)
+  UnrolledSkipList(double p = 0.5) : gd(1.0 - p) {
+    init_head();
+  }
+  UnrolledSkipList(const UnrolledSkipList &) = delete;
+  UnrolledSkipList &operator=(const UnrolledSkipList &) = delete;
+  ~UnrolledSkipList() {
+    destroy_values();
+  }
+
+  Iterator begin() { return Iterator(head->next[0]); }
+  Iterator end() { return Iterator(nullptr); }
+  size_t size() const { return n; }
+
+  // gets first instance of value
+  // returns nullptr if none exist
+  T *find(const T &value) const {
+    Node *prev = search_prev(value);
+    size_t pos = prev == head ? 0 : lower_pos(prev, value);
+    if (pos == prev->count) {
+      prev = prev->next[0];
+      pos = 0;
+    }
+    return prev == nullptr || pos == prev->count || prev->keys[pos] != value ? nullptr : &prev->keys[pos];
+  }
+
+  // insert one instance of this value
+  void insert(T value) {
+    Node *update[L];
+    search_prev(value, update);
+    insert_at(std::move(value), update);
+  }
+
+  // insert value if not in skiplist
+  // return true if insertion performed
+  bool insert_if_none(T value) {
+    Node *update[L];
+    search_prev(value, update);
+    if (find_in(update[0], value) != nullptr)
+      return false;
+
+    insert_at(std::move(value), update);
+    return true;
+  }
+
+  // remove one instance of this value
+  // return true if removal performed
+  bool erase(const T &value) {
+    Node *update[L];
+    Node *prev = search_prev(value, update);
+    Node *node = prev;
+    size_t pos = prev == head ? 0 : lower_pos(prev, value);
+    if (pos == prev->count) {
+      node = prev->next[0];
+      pos = 0;
+    }
+    if (node == nullptr || pos == node->count || node->keys[pos] != value)
+      return false;
+
+    std::move(node->keys + pos + 1, node->keys + node->count, node->keys + pos);
+    node->keys[--node->count] = padding();
+    --n;
+
+    // node is either prev (which keeps its first element) or the block right after it
+    // either way update holds the predecessors of the block after prev
+    if (node->count == 0)
+      unlink_next(update);
+    else if (node->count < B / 2 && prev != head && prev->next[0] != nullptr
+        && prev->count + prev->next[0]->count <= B) {
+      // merge underfull block into prev
+      Node *next = prev->next[0];
+      std::move(next->keys, next->keys + next->count, prev->keys + prev->count);
+      prev->count += next->count;
+      unlink_next(update);
+    }
+    return true;
+  }
+
+  // clears list (releases all block memory at once)
+  void clear() {
+    destroy_values();
+    arena.release();
+    init_head();
+    n = 0;
+  }
+private:
+  size_t n = 0;
+
+  Node *head;
+  Arena arena;
+  FreeNode *free_nodes[L] = {}; // free lists of released nodes (index = layers - 1)
+
+  std::default_random_engine rng;
+  std::geometric_distribution<size_t> gd;
+
+  // fills unused key slots so they never compare less than a searched value
+  static T padding() {
+    if constexpr (std::numeric_limits<T>::has_infinity)
+      return std::numeric_limits<T>::infinity();
+    else if constexpr (std::is_arithmetic_v<T>)
+      return std::numeric_limits<T>::max();
+    else
+      return T();
+  }
+
+  // index of first element in block at least value
+  static size_t lower_pos(const Node *node, const T &value) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      // counts over the whole (padded) block so the loop has a fixed trip count and no branches
+      size_t pos = 0;
+      for (size_t i = 0; i < B; ++i)
+        pos += node->keys[i] < value;
+      return std::min<size_t>(pos, node->count);
+    } else
+      return std::lower_bound(node->keys, node->keys + node->count, value) - node->keys;
+  }
+
+  // finds value in prev (last block with first element less than value) or the block after it
+  T *find_in(Node *prev, const T &value) const {
+    size_t pos = prev == head ? 0 : lower_pos(prev, value);
+    if (pos == prev->count) {
+      prev = prev->next[0];
+      pos = 0;
+    }
+    return prev == nullptr || prev->keys[pos] != value ? nullptr : &prev->keys[pos];
+  }
+
+  // inserts value into the block it belongs in, splitting that block if full
+  void insert_at(T &&value, Node **update) {
+    Node *node = update[0];
+    size_t pos;
+    if (node == head) {
+      // value is not greater than any element, goes at the front of the first block
+      node = head->next[0];
+      if (node == nullptr) {
+        node = create_node(sample_layers());
+        link_after(head, node, update);
+      }
+      pos = 0;
+    } else
+      pos = lower_pos(node, value);
+
+    if (node->count == B) {
+      Node *split = create_node(sample_layers());
+      size_t half = B / 2;
+      std::move(node->keys + half, node->keys + B, split->keys);
+      std::fill(node->keys + half, node->keys + B, padding());
+      split->count = B - half;
+      node->count = half;
+      link_after(node, split, update);
+      if (pos > half) {
+        node = split;
+        pos -= half;
+      }
+    }
+
+    std::move_backward(node->keys + pos, node->keys + node->count, node->keys + node->count + 1);
+    node->keys[pos] = std::move(value);
+    ++node->count;
+    ++n;
+  }
+
+  // links node directly after prev in layer 0
+  // update[i] must be the last node in layer i at or before prev
+  void link_after(Node *prev, Node *node, Node **update) {
+    for (size_t i = 0; i < node->layers; ++i) {
+      Node *pred = i < prev->layers ? prev : update[i];
+      node->next[i] = pred->next[i];
+      pred->next[i] = node;
+    }
+  }
+
+  // removes the block after update[0], given its predecessors in update
+  void unlink_next(Node **update) {
+    Node *node = update[0]->next[0];
+    for (size_t i = 0; i < node->layers; ++i)
+      update[i]->next[i] = node->next[i];
+    destroy_node(node);
+  }
+
+  // bytes occupied by a node with the given number of layers
+  static constexpr size_t node_bytes(size_t layers) {
+    return sizeof(Node) + (layers - 1) * sizeof(Node *);
+  }
+
+  // allocates node from the free list of its height (or the arena if empty)
+  Node *create_node(size_t layers) {
+    void *mem = free_nodes[layers - 1];
+    if (mem != nullptr)
+      free_nodes[layers - 1] = free_nodes[layers - 1]->next;
+    else
+      mem = arena.allocate(node_bytes(layers), alignof(Node));
+    return new (mem) Node(layers);
+  }
+
+  // returns node memory to the free list of its height
+  void destroy_node(Node *node) {
+    size_t layers = node->layers;
+    node->~Node();
+    free_nodes[layers - 1] = new (node) FreeNode{free_nodes[layers - 1]};
+  }
+
+  // runs destructors of all nodes without freeing their memory
+  void destroy_values() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      Node *curr = head;
+      while (curr != nullptr) {
+        Node *next = curr->next[0];
+        curr->~Node();
+        curr = next;
+      }
+    }
+  }
+
+  void init_head() {
+    for (size_t i = 0; i < L; ++i)
+      free_nodes[i] = nullptr;
+    head = create_node(L);
+    for (size_t i = 0; i < L; ++i)
+      head->next[i] = nullptr;
+  }
+
+  // finds last block with first element less than target
+  // if update is given, stores the last such block of each layer in it
+  Node *search_prev(const T &target, Node **update = nullptr) const {
+    Node *curr = head;
+    for (size_t layer = L; layer-- > 0;) {
+      while (curr->next[layer] != nullptr && curr->next[layer]->keys[0] < target)
+        curr = curr->next[layer];
+      if (update != nullptr)
+        update[layer] = curr;
+    }
+    return curr;
+  }
+
+  size_t sample_layers() {
+    return std::min(gd(rng) + 1, L);
+  }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+#include <vector>
+
+// Arena - bump allocator that carves allocations out of large slabs
+// individual allocations are never freed, all memory is released at once
+// (collections keep their own free lists on top of this to reuse memory)
+class Arena {
+public:
+  // slab_size: bytes per slab (allocations larger than this get their own slab)
+  Arena(size_t slab_size = 4096) : slab_size(slab_size) {}
+  Arena(const Arena &) = delete;
+  Arena(Arena &&other) = default;
+  Arena &operator=(const Arena &) = delete;
+  Arena &operator=(Arena &&other) = default;
+
+  // returns uninitialized memory of the given size and alignment
+  void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+    uintptr_t pos = (reinterpret_cast<uintptr_t>(curr) + align - 1) & ~(uintptr_t)(align - 1);
+    if (curr == nullptr || pos + bytes > reinterpret_cast<uintptr_t>(last)) {
+      // start new slab
+      size_t size = std::max(slab_size, bytes + align);
+      slabs.emplace_back(new std::byte[size]);
+      curr = slabs.back().get();
+      last = curr + size;
+      pos = (reinterpret_cast<uintptr_t>(curr) + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    curr = reinterpret_cast<std::byte *>(pos + bytes);
+    return reinterpret_cast<void *>(pos);
+  }
+
+  // frees every slab (all memory handed out becomes invalid)
+  void release() {
+    slabs.clear();
+    curr = last = nullptr;
+  }
+
+  size_t slab_count() const { return slabs.size(); }
+private:
+  size_t slab_size;
+  std::vector<std::unique_ptr<std::byte[]>> slabs;
+  std::byte *curr = nullptr; // next free byte in the current slab
+  std::byte *last = nullptr; // end of the current slab
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Epoch based memory reclamation for lock-free collections
+// threads pin the global epoch while they can hold pointers to shared nodes (EpochGuard)
+// unlinked nodes are retired and only freed once no pinned thread can still reach them
+class EpochManager {
+  // memory waiting to be freed
+  struct Retired {
+    uint64_t epoch; // global epoch at time of retirement
+    void *ptr;
+    void (*deleter)(void *);
+  };
+
+  // per-thread state (records are reused after their thread exits but never freed)
+  struct Record {
+    std::atomic<uint64_t> epoch = 0; // epoch pinned by the thread (0 if not pinned)
+    std::atomic<bool> in_use = true;
+    size_t depth = 0; // number of nested pins
+    std::vector<Retired> retired;
+    Record *next = nullptr;
+  };
+
+  // hands the record back when its thread exits
+  struct ThreadHandle {
+    Record *record = nullptr;
+    ~ThreadHandle() {
+      if (record != nullptr)
+        EpochManager::instance().release(record);
+    }
+  };
+public:
+  static EpochManager &instance() {
+    static EpochManager manager;
+    return manager;
+  }
+
+  // pin/unpin may be nested, the thread stays pinned until the outermost unpin
+  void pin() {
+    Record *rec = thread_record();
+    if (rec->depth++ == 0) {
+      rec->epoch.store(epoch.load(), std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+  void unpin() {
+    Record *rec = thread_record();
+    if (--rec->depth == 0)
+      rec->epoch.store(0, std::memory_order_release);
+  }
+
+  // schedules ptr to be freed by deleter once it is unreachable
+  // ptr must already be unlinked from the shared structure
+  void retire(void *ptr, void (*deleter)(void *)) {
+    Record *rec = thread_record();
+    rec->retired.push_back({ epoch.load(), ptr, deleter });
+    if (rec->retired.size() >= collect_threshold)
+      collect(rec);
+  }
+private:
+  static constexpr size_t collect_threshold = 64;
+
+  std::atomic<uint64_t> epoch = 1;
+  std::atomic<Record *> records = nullptr;
+  std::mutex orphan_mutex;
+  std::vector<Retired> orphans; // retired memory left behind by exited threads
+
+  EpochManager() {}
+  ~EpochManager() {
+    Record *rec = records.load();
+    while (rec != nullptr) {
+      for (Retired &r : rec->retired)
+        r.deleter(r.ptr);
+      Record *next = rec->next;
+      delete rec;
+      rec = next;
+    }
+    for (Retired &r : orphans)
+      r.deleter(r.ptr);
+  }
+
+  Record *thread_record() {
+    thread_local ThreadHandle handle;
+    if (handle.record == nullptr)
+      handle.record = acquire();
+    return handle.record;
+  }
+
+  // reuses a record released by an exited thread or creates a new one
+  Record *acquire() {
+    for (Record *rec = records.load(); rec != nullptr; rec = rec->next) {
+      bool expected = false;
+      if (rec->in_use.compare_exchange_strong(expected, true))
+        return rec;
+    }
+    Record *rec = new Record();
+    rec->next = records.load();
+    while (!records.compare_exchange_weak(rec->next, rec));
+    return rec;
+  }
+
+  void release(Record *rec) {
+    {
+      std::lock_guard<std::mutex> lock(orphan_mutex);
+      orphans.insert(orphans.end(), rec->retired.begin(), rec->retired.end());
+    }
+    rec->retired.clear();
+    rec->depth = 0;
+    rec->epoch.store(0);
+    rec->in_use.store(false);
+  }
+
+  // advances the global epoch if every pinned thread has seen the current one
+  void try_advance() {
+    uint64_t curr = epoch.load();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (Record *rec = records.load(); rec != nullptr; rec = rec->next) {
+      uint64_t pinned = rec->epoch.load(std::memory_order_acquire);
+      if (pinned != 0 && pinned != curr)
+        return;
+    }
+    epoch.compare_exchange_strong(curr, curr + 1);
+  }
+
+  void collect(Record *rec) {
+    try_advance();
+    uint64_t curr = epoch.load();
+    free_retired(rec->retired, curr);
+    if (orphan_mutex.try_lock()) {
+      free_retired(orphans, curr);
+      orphan_mutex.unlock();
+    }
+  }
+
+  // frees memory retired at least 2 epochs ago
+  // (every thread pinned when it was retired has since unpinned)
+  static void free_retired(std::vector<Retired> &list, uint64_t curr) {
+    size_t j = 0;
+    for (size_t i = 0; i < list.size(); ++i) {
+      if (list[i].epoch + 2 <= curr)
+        list[i].deleter(list[i].ptr);
+      else
+        list[j++] = list[i];
+    }
+    list.resize(j);
+  }
+};
+
+// pins the current epoch for the lifetime of the guard
+struct EpochGuard {
+  EpochGuard() { EpochManager::instance().pin(); }
+  ~EpochGuard() { EpochManager::instance().unpin(); }
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+};
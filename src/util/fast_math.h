@@ -0,0 +1,150 @@
+#pragma once
+
+#include "simd.h"
+#include <stddef.h>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+
+// Math policies for geometry types (pass as template argument, ex: v.norm<FastMath>())
+// every policy provides sqrt, rsqrt and atan2 for a single value and for arrays of n values
+// (batch versions allow out to alias the input)
+
+// ExactMath - forwards to <cmath> (default everywhere)
+struct ExactMath {
+  static constexpr bool exact = true;
+
+  template<class T>
+  static T sqrt(T x) { return (T)std::sqrt(x); }
+  template<class T>
+  static T rsqrt(T x) { return T{1} / (T)std::sqrt(x); }
+  template<class T>
+  static T atan2(T y, T x) { return (T)std::atan2(y, x); }
+
+  template<class T>
+  static void sqrt(const T *a, T *out, size_t n) { Batch<T>::sqrt(a, out, n); }
+  template<class T>
+  static void rsqrt(const T *a, T *out, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = rsqrt(a[i]);
+  }
+  template<class T>
+  static void atan2(const T *y, const T *x, T *out, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = atan2(y[i], x[i]);
+  }
+};
+
+// FastMath - approximations for floating point types
+// rsqrt: hardware estimate plus Newton-Raphson steps (1 for float, 2 for double)
+//   relative error < 3e-7 for float, < 1e-13 for double
+//   double inputs must be within float range (the estimate is made in float)
+// sqrt: x * rsqrt(x) (0 for x = 0), same relative error as rsqrt
+// atan2: odd minimax polynomial on one octant, absolute error < 2e-6 rad (not better for double)
+// inputs must be finite, results for x = y = 0 are 0
+struct FastMath {
+  static constexpr bool exact = false;
+
+  template<class T>
+  static T sqrt(T x) {
+    static_assert(std::is_floating_point_v<T>);
+    return x == T{0} ? T{0} : x * rsqrt(x);
+  }
+  template<class T>
+  static T rsqrt(T x) {
+    static_assert(std::is_floating_point_v<T>);
+#if defined(__SSE2__) || defined(_M_X64)
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+      using R = SimdReg<T>;
+      alignas(32) T lanes[R::width] = { x };
+      R::store(lanes, R::rsqrt_approx(R::load(lanes)));
+      return lanes[0];
+    }
+#endif
+    return T{1} / std::sqrt(x);
+  }
+  template<class T>
+  static T atan2(T y, T x) {
+    static_assert(std::is_floating_point_v<T>);
+    // reduce to atan(a) for a in [0, 1], then undo the reflections
+    T ax = std::abs(x), ay = std::abs(y);
+    T a = std::min(ax, ay) / std::max(std::max(ax, ay), std::numeric_limits<T>::min());
+    T r = atan_poly(a);
+    if (ay > ax)
+      r = T(std::numbers::pi / 2) - r;
+    if (x < T{0})
+      r = T(std::numbers::pi) - r;
+    return std::copysign(r, y);
+  }
+
+  template<class T>
+  static void sqrt(const T *a, T *out, size_t n) {
+    using R = SimdReg<T>;
+    size_t i = 0;
+    for (; i + R::width <= n; i += R::width)
+      R::store(out + i, R::sqrt_approx(R::load(a + i)));
+    for (; i < n; ++i)
+      out[i] = sqrt(a[i]);
+  }
+  template<class T>
+  static void rsqrt(const T *a, T *out, size_t n) {
+    using R = SimdReg<T>;
+    size_t i = 0;
+    for (; i + R::width <= n; i += R::width)
+      R::store(out + i, R::rsqrt_approx(R::load(a + i)));
+    for (; i < n; ++i)
+      out[i] = rsqrt(a[i]);
+  }
+  template<class T>
+  static void atan2(const T *y, const T *x, T *out, size_t n) {
+    using R = SimdReg<T>;
+    using reg = typename R::reg;
+    size_t i = 0;
+    for (; i + R::width <= n; i += R::width) {
+      reg vy = R::load(y + i), vx = R::load(x + i);
+      reg ax = R::abs(vx), ay = R::abs(vy);
+      reg a = R::div(R::min(ax, ay), R::max(R::max(ax, ay), R::set1(std::numeric_limits<T>::min())));
+      reg r = atan_poly<R>(a);
+      r = R::select(R::less(ax, ay), R::sub(R::set1(T(std::numbers::pi / 2)), r), r);
+      r = R::select(R::less(vx, R::set1(T{0})), R::sub(R::set1(T(std::numbers::pi)), r), r);
+      R::store(out + i, R::copysign(r, vy));
+    }
+    for (; i < n; ++i)
+      out[i] = atan2(y[i], x[i]);
+  }
+private:
+  // minimax fit of atan(a) / a in a^2 for a in [0, 1]
+  static constexpr double atan_coeffs[] = { 0.99997726, -0.33262347, 0.19354346, -0.11643287, 0.05265332, -0.01172120 };
+
+  template<class T>
+  static T atan_poly(T a) {
+    T s = a * a;
+    T r = T(atan_coeffs[5]);
+    for (size_t k = 5; k-- > 0;)
+      r = r * s + T(atan_coeffs[k]);
+    return r * a;
+  }
+  template<class R>
+  static typename R::reg atan_poly(typename R::reg a) {
+    using T = decltype(R::hsum(a));
+    typename R::reg s = R::mul(a, a);
+    typename R::reg r = R::set1(T(atan_coeffs[5]));
+    for (size_t k = 5; k-- > 0;)
+      r = R::add(R::mul(r, s), R::set1(T(atan_coeffs[k])));
+    return R::mul(r, a);
+  }
+};
+
+// pseudo angle - cheap stand-in for atan2(y, x) when angles are only compared
+// increases monotonically with atan2(y, x) (same order, including the sign of y at x < 0),
+// range [-2, 2], 0 for x = y = 0
+template<class T>
+T pseudo_angle(T y, T x) {
+  static_assert(std::is_floating_point_v<T>);
+  T sum = std::abs(x) + std::abs(y);
+  T r = sum == T{0} ? T{0} : y / sum;
+  if (x >= T{0})
+    return r;
+  return std::signbit(y) ? T{-2} - r : T{2} - r;
+}
@@ -2,6 +2,7 @@
 
 #include <iterator>
 #include <vector>
+#include <type_traits>
 
 // Iterator templates to improve the readibility of collections
 
@@ -18,7 +19,7 @@ struct LinkedListIterator {
   LinkedListIterator(P *ptr) : ptr(ptr) {}
 
   reference operator*() { return **ptr; }
-  pointer operator->() { return *ptr; }
+  pointer operator->() { return &**ptr; }
   bool operator==(const LinkedListIterator<T, P> &other) const { return ptr == other.ptr; }
   bool operator!=(const LinkedListIterator<T, P> &other) const { return ptr != other.ptr; }
   
@@ -31,6 +32,59 @@ private:
   P *ptr;
 };
 
+// iterator wrapping a doubly linked-list type collection
+// T: element type
+// P: pointer class (has * and -> overloaded like a pointer, next[0] and prev links)
+template<class T, class P>
+struct DoublyLinkedListIterator {
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = std::remove_const_t<T>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T *;
+  using reference = T &;
+  DoublyLinkedListIterator(P *ptr = nullptr) : ptr(ptr) {}
+
+  reference operator*() const { return **ptr; }
+  pointer operator->() const { return &**ptr; }
+  bool operator==(const DoublyLinkedListIterator<T, P> &other) const { return ptr == other.ptr; }
+  bool operator!=(const DoublyLinkedListIterator<T, P> &other) const { return ptr != other.ptr; }
+
+  DoublyLinkedListIterator<T, P> &operator++() {
+    ptr = ptr->next[0];
+    return *this;
+  }
+  DoublyLinkedListIterator<T, P> operator++(int) {
+    DoublyLinkedListIterator<T, P> res = *this;
+    ++*this;
+    return res;
+  }
+
+  DoublyLinkedListIterator<T, P> &operator--() {
+    ptr = ptr->prev;
+    return *this;
+  }
+  DoublyLinkedListIterator<T, P> operator--(int) {
+    DoublyLinkedListIterator<T, P> res = *this;
+    --*this;
+    return res;
+  }
+
+  P *node() const { return ptr; }
+private:
+  P *ptr;
+};
+
+// pair of iterators usable in a range-based for loop
+template<class It>
+struct IteratorRange {
+  It first;
+  It last;
+
+  It begin() const { return first; }
+  It end() const { return last; }
+  bool empty() const { return first == last; }
+};
+
 // iterator wrapping a fixed-memory array
 // T: element type
 template<class T>
@@ -61,3 +115,37 @@ struct ArrayIterator {
 private:
   T *ptr;
 };
+
+// iterator wrapping a linked list of blocks that each hold a sorted array of elements
+// T: element type
+// P: block class (has next[0], keys and count)
+template<class T, class P>
+struct BlockListIterator {
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T *;
+  using reference = T &;
+  BlockListIterator(P *ptr, size_t index = 0) : ptr(ptr), index(index) {}
+
+  reference operator*() { return ptr->keys[index]; }
+  pointer operator->() { return &ptr->keys[index]; }
+  bool operator==(const BlockListIterator<T, P> &other) const { return ptr == other.ptr && index == other.index; }
+  bool operator!=(const BlockListIterator<T, P> &other) const { return !(*this == other); }
+
+  BlockListIterator<T, P> &operator++() {
+    if (++index == ptr->count) {
+      ptr = ptr->next[0];
+      index = 0;
+    }
+    return *this;
+  }
+  BlockListIterator<T, P> operator++(int) {
+    BlockListIterator<T, P> res = *this;
+    ++*this;
+    return res;
+  }
+private:
+  P *ptr;
+  size_t index;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// MappedFile - read-only memory mapping of a whole file
+// contents are paged in on access instead of being copied into a buffer
+class MappedFile {
+public:
+  MappedFile(const char *path) {
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+      return;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+      return;
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+      return;
+    ptr = static_cast<const std::byte *>(view);
+    len = file_size.QuadPart;
+#else
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+      return;
+    void *view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+      return;
+    madvise(view, st.st_size, MADV_SEQUENTIAL);
+    ptr = static_cast<const std::byte *>(view);
+    len = st.st_size;
+#endif
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() {
+#ifdef _WIN32
+    if (ptr != nullptr)
+      UnmapViewOfFile(ptr);
+    if (mapping != nullptr)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+#else
+    if (ptr != nullptr)
+      munmap(const_cast<std::byte *>(ptr), len);
+    if (fd >= 0)
+      close(fd);
+#endif
+  }
+
+  // false if the file could not be opened or is empty
+  bool is_open() const { return ptr != nullptr; }
+  const std::byte *data() const { return ptr; }
+  size_t size() const { return len; }
+private:
+  const std::byte *ptr = nullptr;
+  size_t len = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+};
@@ -0,0 +1,528 @@
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+// SIMD register wrappers so batch kernels can be written once for every element type
+// float and double use AVX (8/4 lanes) or SSE2 (4/2 lanes) when the compiler targets them,
+// every other type (or target) falls back to one element per "register"
+
+// one element per "register", the fallback for every type (and for kernels narrower than a register)
+// min and max return b when either is NaN, same as the SSE and AVX instructions
+
+// T: element type
+template<class T>
+struct ScalarReg {
+  using reg = T;
+  static constexpr size_t width = 1;
+
+  static reg load(const T *p) { return *p; }
+  static void store(T *p, reg r) { *p = r; }
+  static reg set1(T v) { return v; }
+  static reg add(reg a, reg b) { return a + b; }
+  static reg sub(reg a, reg b) { return a - b; }
+  static reg mul(reg a, reg b) { return a * b; }
+  static reg div(reg a, reg b) { return a / b; }
+  static reg sqrt(reg a) { return (T)std::sqrt(a); }
+  static reg min(reg a, reg b) { return a < b ? a : b; }
+  static reg max(reg a, reg b) { return a > b ? a : b; }
+  static reg rsqrt_approx(reg a) { return T{1} / (T)std::sqrt(a); }
+  static reg sqrt_approx(reg a) { return (T)std::sqrt(a); }
+  static reg abs(reg a) { return a < T{0} ? -a : a; }
+  static reg copysign(reg mag, reg sign) { return (T)std::copysign(mag, sign); }
+  static reg less(reg a, reg b) { return a < b ? T{1} : T{0}; }
+  static reg select(reg mask, reg if_true, reg if_false) { return mask != T{0} ? if_true : if_false; }
+  static uint32_t bits(reg mask) { return mask != T{0}; }
+  static T hsum(reg a) { return a; }
+  static T hmin(reg a) { return a; }
+  static T hmax(reg a) { return a; }
+};
+
+template<class T>
+struct SimdReg : ScalarReg<T> {};
+
+// 4 float or 2 double lanes where SSE2 is available
+template<class T>
+struct SseReg : ScalarReg<T> {};
+
+#if defined(__SSE2__) || defined(_M_X64)
+template<>
+struct SseReg<float> {
+  using reg = __m128;
+  static constexpr size_t width = 4;
+
+  static reg load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, reg r) { _mm_storeu_ps(p, r); }
+  static reg set1(float v) { return _mm_set1_ps(v); }
+  static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+  static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+  static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+  static reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+  static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+  // estimate refined by Newton-Raphson (see FastMath for error bounds)
+  static reg rsqrt_approx(reg a) {
+    reg y = _mm_rsqrt_ps(a);
+    y = newton_rsqrt(a, y);
+    return y;
+  }
+  // a * rsqrt(a), 0 where a is 0
+  static reg sqrt_approx(reg a) {
+    return _mm_and_ps(mul(a, rsqrt_approx(a)), _mm_cmpneq_ps(a, _mm_setzero_ps()));
+  }
+  static reg abs(reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+  static reg copysign(reg mag, reg sign) {
+    reg sign_bit = _mm_set1_ps(-0.0f);
+    return _mm_or_ps(_mm_andnot_ps(sign_bit, mag), _mm_and_ps(sign_bit, sign));
+  }
+  // masks are all ones in lanes where the comparison holds
+  static reg less(reg a, reg b) { return _mm_cmplt_ps(a, b); }
+  static reg select(reg mask, reg if_true, reg if_false) { return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false)); }
+  // lane i of a mask is bit i
+  static uint32_t bits(reg mask) { return uint32_t(_mm_movemask_ps(mask)); }
+  static float hsum(reg a) { return reduce(a, [](float x, float y) { return x + y; }); }
+  static float hmin(reg a) { return reduce(a, [](float x, float y) { return std::min(x, y); }); }
+  static float hmax(reg a) { return reduce(a, [](float x, float y) { return std::max(x, y); }); }
+private:
+  // y * (1.5 - 0.5 * a * y * y)
+  static reg newton_rsqrt(reg a, reg y) {
+    return mul(y, sub(set1(1.5f), mul(mul(set1(0.5f), a), mul(y, y))));
+  }
+
+  template<class F>
+  static float reduce(reg a, F f) {
+    alignas(16) float lanes[width];
+    _mm_store_ps(lanes, a);
+    float res = lanes[0];
+    for (size_t i = 1; i < width; ++i)
+      res = f(res, lanes[i]);
+    return res;
+  }
+};
+
+template<>
+struct SseReg<double> {
+  using reg = __m128d;
+  static constexpr size_t width = 2;
+
+  static reg load(const double *p) { return _mm_loadu_pd(p); }
+  static void store(double *p, reg r) { _mm_storeu_pd(p, r); }
+  static reg set1(double v) { return _mm_set1_pd(v); }
+  static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+  static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+  static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+  static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+  static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+  // estimate refined by Newton-Raphson (see FastMath for error bounds)
+  static reg rsqrt_approx(reg a) {
+    reg y = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(a)));
+    y = newton_rsqrt(a, y);
+    y = newton_rsqrt(a, y);
+    return y;
+  }
+  // a * rsqrt(a), 0 where a is 0
+  static reg sqrt_approx(reg a) {
+    return _mm_and_pd(mul(a, rsqrt_approx(a)), _mm_cmpneq_pd(a, _mm_setzero_pd()));
+  }
+  static reg abs(reg a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+  static reg copysign(reg mag, reg sign) {
+    reg sign_bit = _mm_set1_pd(-0.0);
+    return _mm_or_pd(_mm_andnot_pd(sign_bit, mag), _mm_and_pd(sign_bit, sign));
+  }
+  // masks are all ones in lanes where the comparison holds
+  static reg less(reg a, reg b) { return _mm_cmplt_pd(a, b); }
+  static reg select(reg mask, reg if_true, reg if_false) { return _mm_or_pd(_mm_and_pd(mask, if_true), _mm_andnot_pd(mask, if_false)); }
+  // lane i of a mask is bit i
+  static uint32_t bits(reg mask) { return uint32_t(_mm_movemask_pd(mask)); }
+  static double hsum(reg a) { return reduce(a, [](double x, double y) { return x + y; }); }
+  static double hmin(reg a) { return reduce(a, [](double x, double y) { return std::min(x, y); }); }
+  static double hmax(reg a) { return reduce(a, [](double x, double y) { return std::max(x, y); }); }
+private:
+  // y * (1.5 - 0.5 * a * y * y)
+  static reg newton_rsqrt(reg a, reg y) {
+    return mul(y, sub(set1(1.5), mul(mul(set1(0.5), a), mul(y, y))));
+  }
+
+  template<class F>
+  static double reduce(reg a, F f) {
+    alignas(16) double lanes[width];
+    _mm_store_pd(lanes, a);
+    double res = lanes[0];
+    for (size_t i = 1; i < width; ++i)
+      res = f(res, lanes[i]);
+    return res;
+  }
+};
+#endif
+
+// next register narrower than SimdReg<T> (SseReg under AVX, otherwise ScalarReg)
+template<class T>
+struct HalfReg : ScalarReg<T> {};
+
+#if defined(__AVX__)
+template<>
+struct SimdReg<float> {
+  using reg = __m256;
+  static constexpr size_t width = 8;
+
+  static reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, reg r) { _mm256_storeu_ps(p, r); }
+  static reg set1(float v) { return _mm256_set1_ps(v); }
+  static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+  static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+  static reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+  static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+  // estimate refined by Newton-Raphson (see FastMath for error bounds)
+  static reg rsqrt_approx(reg a) {
+    reg y = _mm256_rsqrt_ps(a);
+    y = newton_rsqrt(a, y);
+    return y;
+  }
+  // a * rsqrt(a), 0 where a is 0
+  static reg sqrt_approx(reg a) {
+    return _mm256_and_ps(mul(a, rsqrt_approx(a)), _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+  }
+  static reg abs(reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+  static reg copysign(reg mag, reg sign) {
+    reg sign_bit = _mm256_set1_ps(-0.0f);
+    return _mm256_or_ps(_mm256_andnot_ps(sign_bit, mag), _mm256_and_ps(sign_bit, sign));
+  }
+  // masks are all ones in lanes where the comparison holds
+  static reg less(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static reg select(reg mask, reg if_true, reg if_false) { return _mm256_blendv_ps(if_false, if_true, mask); }
+  // lane i of a mask is bit i
+  static uint32_t bits(reg mask) { return uint32_t(_mm256_movemask_ps(mask)); }
+  static float hsum(reg a) { return reduce(a, [](float x, float y) { return x + y; }); }
+  static float hmin(reg a) { return reduce(a, [](float x, float y) { return std::min(x, y); }); }
+  static float hmax(reg a) { return reduce(a, [](float x, float y) { return std::max(x, y); }); }
+private:
+  // y * (1.5 - 0.5 * a * y * y)
+  static reg newton_rsqrt(reg a, reg y) {
+    return mul(y, sub(set1(1.5f), mul(mul(set1(0.5f), a), mul(y, y))));
+  }
+
+  template<class F>
+  static float reduce(reg a, F f) {
+    alignas(32) float lanes[width];
+    _mm256_store_ps(lanes, a);
+    float res = lanes[0];
+    for (size_t i = 1; i < width; ++i)
+      res = f(res, lanes[i]);
+    return res;
+  }
+};
+
+template<>
+struct SimdReg<double> {
+  using reg = __m256d;
+  static constexpr size_t width = 4;
+
+  static reg load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, reg r) { _mm256_storeu_pd(p, r); }
+  static reg set1(double v) { return _mm256_set1_pd(v); }
+  static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+  static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+  static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+  static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+  // estimate refined by Newton-Raphson (see FastMath for error bounds)
+  static reg rsqrt_approx(reg a) {
+    reg y = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(a)));
+    y = newton_rsqrt(a, y);
+    y = newton_rsqrt(a, y);
+    return y;
+  }
+  // a * rsqrt(a), 0 where a is 0
+  static reg sqrt_approx(reg a) {
+    return _mm256_and_pd(mul(a, rsqrt_approx(a)), _mm256_cmp_pd(a, _mm256_setzero_pd(), _CMP_NEQ_UQ));
+  }
+  static reg abs(reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+  static reg copysign(reg mag, reg sign) {
+    reg sign_bit = _mm256_set1_pd(-0.0);
+    return _mm256_or_pd(_mm256_andnot_pd(sign_bit, mag), _mm256_and_pd(sign_bit, sign));
+  }
+  // masks are all ones in lanes where the comparison holds
+  static reg less(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static reg select(reg mask, reg if_true, reg if_false) { return _mm256_blendv_pd(if_false, if_true, mask); }
+  // lane i of a mask is bit i
+  static uint32_t bits(reg mask) { return uint32_t(_mm256_movemask_pd(mask)); }
+  static double hsum(reg a) { return reduce(a, [](double x, double y) { return x + y; }); }
+  static double hmin(reg a) { return reduce(a, [](double x, double y) { return std::min(x, y); }); }
+  static double hmax(reg a) { return reduce(a, [](double x, double y) { return std::max(x, y); }); }
+private:
+  // y * (1.5 - 0.5 * a * y * y)
+  static reg newton_rsqrt(reg a, reg y) {
+    return mul(y, sub(set1(1.5), mul(mul(set1(0.5), a), mul(y, y))));
+  }
+
+  template<class F>
+  static double reduce(reg a, F f) {
+    alignas(32) double lanes[width];
+    _mm256_store_pd(lanes, a);
+    double res = lanes[0];
+    for (size_t i = 1; i < width; ++i)
+      res = f(res, lanes[i]);
+    return res;
+  }
+};
+template<>
+struct HalfReg<float> : SseReg<float> {};
+template<>
+struct HalfReg<double> : SseReg<double> {};
+#elif defined(__SSE2__) || defined(_M_X64)
+template<>
+struct SimdReg<float> : SseReg<float> {};
+template<>
+struct SimdReg<double> : SseReg<double> {};
+#endif
+
+// widest register whose width divides N, for kernels over N lanes
+template<class T, size_t N>
+using DividingReg = std::conditional_t<N % SimdReg<T>::width == 0, SimdReg<T>,
+  std::conditional_t<N % HalfReg<T>::width == 0, HalfReg<T>, ScalarReg<T>>>;
+
+// static class of batch kernels over contiguous arrays of length n
+// each kernel runs full registers first, then finishes the remainder one element at a time
+// (out may alias an input)
+template<class T>
+struct Batch {
+  using R = SimdReg<T>;
+  using reg = typename R::reg;
+
+  static void add(const T *a, const T *b, T *out, size_t n) { map(a, b, out, n, R::add, [](T x, T y) { return x + y; }); }
+  static void sub(const T *a, const T *b, T *out, size_t n) { map(a, b, out, n, R::sub, [](T x, T y) { return x - y; }); }
+  static void mul(const T *a, const T *b, T *out, size_t n) { map(a, b, out, n, R::mul, [](T x, T y) { return x * y; }); }
+  static void div(const T *a, const T *b, T *out, size_t n) { map(a, b, out, n, R::div, [](T x, T y) { return x / y; }); }
+  static void add(const T *a, T s, T *out, size_t n) { map(a, s, out, n, R::add, [](T x, T y) { return x + y; }); }
+  static void sub(const T *a, T s, T *out, size_t n) { map(a, s, out, n, R::sub, [](T x, T y) { return x - y; }); }
+  static void mul(const T *a, T s, T *out, size_t n) { map(a, s, out, n, R::mul, [](T x, T y) { return x * y; }); }
+  static void div(const T *a, T s, T *out, size_t n) { map(a, s, out, n, R::div, [](T x, T y) { return x / y; }); }
+
+  // out[i] += a[i] * b[i]
+  static void mul_add(const T *a, const T *b, T *out, size_t n) {
+    size_t i = 0;
+    for (; i + R::width <= n; i += R::width)
+      R::store(out + i, R::add(R::load(out + i), R::mul(R::load(a + i), R::load(b + i))));
+    for (; i < n; ++i)
+      out[i] += a[i] * b[i];
+  }
+
+  // out[i] += a[i] * s
+  static void mul_add(const T *a, T s, T *out, size_t n) {
+    size_t i = 0;
+    reg sv = R::set1(s);
+    for (; i + R::width <= n; i += R::width)
+      R::store(out + i, R::add(R::load(out + i), R::mul(R::load(a + i), sv)));
+    for (; i < n; ++i)
+      out[i] += a[i] * s;
+  }
+
+  static void sqrt(const T *a, T *out, size_t n) {
+    size_t i = 0;
+    for (; i + R::width <= n; i += R::width)
+      R::store(out + i, R::sqrt(R::load(a + i)));
+    for (; i < n; ++i)
+      out[i] = (T)std::sqrt(a[i]);
+  }
+
+  // reductions (n >= 1)
+  static T min(const T *a, size_t n) { return reduce(a, n, R::min, R::hmin, [](T x, T y) { return std::min(x, y); }); }
+  static T max(const T *a, size_t n) { return reduce(a, n, R::max, R::hmax, [](T x, T y) { return std::max(x, y); }); }
+  static T sum(const T *a, size_t n) { return reduce(a, n, R::add, R::hsum, [](T x, T y) { return x + y; }); }
+private:
+  // out[i] = op(a[i], b[i])
+  template<class ScalarOp>
+  static void map(const T *a, const T *b, T *out, size_t n, reg (*op)(reg, reg), ScalarOp scalar_op) {
+    size_t i = 0;
+    for (; i + R::width <= n; i += R::width)
+      R::store(out + i, op(R::load(a + i), R::load(b + i)));
+    for (; i < n; ++i)
+      out[i] = scalar_op(a[i], b[i]);
+  }
+
+  // out[i] = op(a[i], s)
+  template<class ScalarOp>
+  static void map(const T *a, T s, T *out, size_t n, reg (*op)(reg, reg), ScalarOp scalar_op) {
+    size_t i = 0;
+    reg sv = R::set1(s);
+    for (; i + R::width <= n; i += R::width)
+      R::store(out + i, op(R::load(a + i), sv));
+    for (; i < n; ++i)
+      out[i] = scalar_op(a[i], s);
+  }
+
+  template<class ScalarOp>
+  static T reduce(const T *a, size_t n, reg (*op)(reg, reg), T (*horizontal)(reg), ScalarOp scalar_op) {
+    size_t i = 0;
+    T res;
+    if (n >= R::width) {
+      reg acc = R::load(a);
+      for (i = R::width; i + R::width <= n; i += R::width)
+        acc = op(acc, R::load(a + i));
+      res = horizontal(acc);
+    } else
+      res = a[i++];
+    for (; i < n; ++i)
+      res = scalar_op(res, a[i]);
+    return res;
+  }
+};
+
+// one small vector of W lanes (W = 2 or 4) held in a single register (or register pair),
+// used by Vec specializations whose storage is padded to W elements and aligned to W * sizeof(T)
+// every lane op works on all W lanes, so lanes past the vector's dimensions must be kept 0
+// enabled is false for every type and width without a specialization
+
+// T: element type
+// W: lane count
+template<class T, size_t W>
+struct SimdLanes {
+  static constexpr bool enabled = false;
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+namespace simd_detail {
+  // sums all 4 float lanes into every lane
+  inline __m128 hsum_ps(__m128 a) {
+    a = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+  }
+  // sums both double lanes into every lane
+  inline __m128d hsum_pd(__m128d a) {
+    return _mm_add_pd(a, _mm_shuffle_pd(a, a, 1));
+  }
+}
+
+template<size_t W>
+struct SimdLanesF32 {
+  static constexpr bool enabled = true;
+  using reg = __m128;
+
+  // W = 2 moves only the low 64 bits (upper lanes load as 0)
+  static reg load(const float *p) {
+    if constexpr (W == 2)
+      return _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(p));
+    else
+      return _mm_load_ps(p);
+  }
+  static void store(float *p, reg r) {
+    if constexpr (W == 2)
+      _mm_storel_pi(reinterpret_cast<__m64 *>(p), r);
+    else
+      _mm_store_ps(p, r);
+  }
+  static reg set1(float v) { return _mm_set1_ps(v); }
+  static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+  static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+  static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+  static reg neg(reg a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+  static reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+  static reg hsum(reg a) { return simd_detail::hsum_ps(a); }
+  static float first(reg a) { return _mm_cvtss_f32(a); }
+
+  // zeroes lanes at index count and above
+  static reg keep(reg a, size_t count) {
+    alignas(16) static constexpr uint32_t masks[8] = { ~0u, ~0u, ~0u, ~0u, 0, 0, 0, 0 };
+    return _mm_and_ps(a, _mm_loadu_ps(reinterpret_cast<const float *>(masks + 4 - count)));
+  }
+};
+template<> struct SimdLanes<float, 2> : SimdLanesF32<2> {};
+template<> struct SimdLanes<float, 4> : SimdLanesF32<4> {};
+
+template<>
+struct SimdLanes<double, 2> {
+  static constexpr bool enabled = true;
+  using reg = __m128d;
+
+  static reg load(const double *p) { return _mm_load_pd(p); }
+  static void store(double *p, reg r) { _mm_store_pd(p, r); }
+  static reg set1(double v) { return _mm_set1_pd(v); }
+  static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+  static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+  static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+  static reg neg(reg a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+  static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+  static reg hsum(reg a) { return simd_detail::hsum_pd(a); }
+  static double first(reg a) { return _mm_cvtsd_f64(a); }
+  static reg keep(reg a, size_t) { return a; }
+};
+
+#if defined(__AVX__)
+template<>
+struct SimdLanes<double, 4> {
+  static constexpr bool enabled = true;
+  using reg = __m256d;
+
+  static reg load(const double *p) { return _mm256_load_pd(p); }
+  static void store(double *p, reg r) { _mm256_store_pd(p, r); }
+  static reg set1(double v) { return _mm256_set1_pd(v); }
+  static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+  static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+  static reg neg(reg a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+  static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+  static reg hsum(reg a) {
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+    half = simd_detail::hsum_pd(half);
+    return _mm256_set_m128d(half, half);
+  }
+  static double first(reg a) { return _mm256_cvtsd_f64(a); }
+  static reg keep(reg a, size_t count) {
+    alignas(32) static constexpr uint64_t masks[8] = { ~0ull, ~0ull, ~0ull, ~0ull, 0, 0, 0, 0 };
+    return _mm256_and_pd(a, _mm256_loadu_pd(reinterpret_cast<const double *>(masks + 4 - count)));
+  }
+};
+#else
+// without AVX 4 doubles take a pair of SSE2 registers
+template<>
+struct SimdLanes<double, 4> {
+  static constexpr bool enabled = true;
+  struct reg {
+    __m128d lo, hi;
+  };
+
+  static reg load(const double *p) { return { _mm_load_pd(p), _mm_load_pd(p + 2) }; }
+  static void store(double *p, reg r) {
+    _mm_store_pd(p, r.lo);
+    _mm_store_pd(p + 2, r.hi);
+  }
+  static reg set1(double v) { return { _mm_set1_pd(v), _mm_set1_pd(v) }; }
+  static reg add(reg a, reg b) { return { _mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi) }; }
+  static reg sub(reg a, reg b) { return { _mm_sub_pd(a.lo, b.lo), _mm_sub_pd(a.hi, b.hi) }; }
+  static reg mul(reg a, reg b) { return { _mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi) }; }
+  static reg div(reg a, reg b) { return { _mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi) }; }
+  static reg neg(reg a) { return { _mm_xor_pd(a.lo, _mm_set1_pd(-0.0)), _mm_xor_pd(a.hi, _mm_set1_pd(-0.0)) }; }
+  static reg sqrt(reg a) { return { _mm_sqrt_pd(a.lo), _mm_sqrt_pd(a.hi) }; }
+  static reg hsum(reg a) {
+    __m128d sum = simd_detail::hsum_pd(_mm_add_pd(a.lo, a.hi));
+    return { sum, sum };
+  }
+  static double first(reg a) { return _mm_cvtsd_f64(a.lo); }
+  static reg keep(reg a, size_t count) {
+    if (count <= 2)
+      a.hi = _mm_setzero_pd();
+    else if (count == 3)
+      a.hi = _mm_move_sd(_mm_setzero_pd(), a.hi);
+    return a;
+  }
+};
+#endif
+#endif